@@ -0,0 +1,604 @@
+// Simple benchmarks for vector_queue, build with optimizations:
+// g++ -std=c++20 -O2 -pthread benchmarks/benchmarks.cpp -I. -o benchmarks/benchmarks
+// Pass the names of the benchmarks to run, or nothing to run all of them.
+#include <vector_queue.h>
+#include <vector_queue_algorithm.h>
+#include <sorted_vector_queue.h>
+#include <incremental_vector_queue.h>
+#include <block_vector_queue.h>
+#include <size_class_allocator.h>
+#include <vector_queue_pool.h>
+#include <huge_page_allocator.h>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <memory_resource>
+#include <numeric>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+template <class T>
+void do_not_optimize(const T& value)
+{
+	asm volatile("" : : "r,m"(value) : "memory");
+}
+
+// the fastest of a few runs in nanoseconds
+template <class F>
+double measure(F&& f, int runs = 7)
+{
+	double best = 1e300;
+	for (int i = 0; i < runs; ++i)
+	{
+		auto start = std::chrono::steady_clock::now();
+		f();
+		std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+		best = std::min(best, elapsed.count());
+	}
+	return best;
+}
+
+// a queue that wraps around the end of its buffer, like one that has been in use for a while
+template <class T>
+vector_queue<T> make_queue(size_t size)
+{
+	vector_queue<T> q;
+	q.reserve(size);
+	for (size_t i = 0; i < size; ++i)
+		q.push_back(T(i % 1000));
+	for (size_t i = 0; i < size / 3; ++i)
+	{
+		q.push_back(q.front());
+		q.pop_front();
+	}
+	return q;
+}
+
+template <class T>
+void reductions(const char* type)
+{
+	for (size_t size : { 1000, 100000, 10000000 })
+	{
+		auto q = make_queue<T>(size);
+		auto accumulate = measure([&] { do_not_optimize(std::accumulate(q.begin(), q.end(), T{})); });
+		auto sum = measure([&] { do_not_optimize(q.sum()); });
+		auto min_element = measure([&] { do_not_optimize(*std::min_element(q.begin(), q.end())); });
+		auto min = measure([&] { do_not_optimize(q.min()); });
+		std::printf("%-8s %9zu  accumulate %10.0f ns  sum %10.0f ns  %5.1fx   min_element %10.0f ns  min %10.0f ns  %5.1fx\n",
+			type, size, accumulate, sum, accumulate / sum, min_element, min, min_element / min);
+	}
+}
+
+void bench_reductions()
+{
+	reductions<int32_t>("int32_t");
+	reductions<float>("float");
+	reductions<double>("double");
+}
+
+// plain range-for loops over the queue against the same loops over a std::vector,
+// writing chars can alias the queue's members which then have to be reloaded for every element
+void bench_iteration()
+{
+	for (size_t size : { 1000, 100000, 10000000 })
+	{
+		auto q = make_queue<int32_t>(size);
+		std::vector<int32_t> v(q.begin(), q.end());
+		auto sum = [](const auto& c)
+		{
+			int32_t total = 0;
+			for (auto value : c)
+				total += value;
+			return total;
+		};
+		auto vector = measure([&] { do_not_optimize(sum(v)); });
+		auto queue = measure([&] { do_not_optimize(sum(q)); });
+		std::printf("sum   %9zu  vector %10.0f ns  vector_queue %10.0f ns  %5.2fx\n", size, vector, queue, queue / vector);
+
+		auto bytes = make_queue<char>(size);
+		std::vector<char> byte_vector(bytes.begin(), bytes.end());
+		std::vector<char> out(size);
+		auto copy = [&](const auto& c)
+		{
+			char* p = out.data();
+			for (auto value : c)
+				*p++ = char(value ^ 1);
+			do_not_optimize(out.data());
+		};
+		vector = measure([&] { copy(byte_vector); });
+		queue = measure([&] { copy(bytes); });
+		std::printf("bytes %9zu  vector %10.0f ns  vector_queue %10.0f ns  %5.2fx\n", size, vector, queue, queue / vector);
+	}
+}
+
+// the parallel algorithms on 1, 2, 4... threads up to the number of cores
+void bench_parallel()
+{
+	auto q = make_queue<int32_t>(50000000);
+	unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+	double base_find = 0, base_count = 0, base_reduce = 0, base_transform = 0;
+	for (unsigned threads = 1; threads <= cores; threads = threads < cores && threads * 2 > cores ? cores : threads * 2)
+	{
+		vq::parallel_policy policy{ threads };
+		auto find = measure([&] { do_not_optimize(vq::find(policy, q, -1)); }, 3);
+		auto count = measure([&] { do_not_optimize(vq::count(policy, q, 7)); }, 3);
+		auto reduce = measure([&] { do_not_optimize(vq::reduce(policy, q, int64_t(0), std::plus<>())); }, 3);
+		auto transform = measure([&] { vq::transform(policy, q, [](int32_t v) { return v ^ 1; }); }, 3);
+		if (threads == 1)
+		{
+			base_find = find;
+			base_count = count;
+			base_reduce = reduce;
+			base_transform = transform;
+		}
+		std::printf("%3u threads  find %6.1f ms %5.1fx  count %6.1f ms %5.1fx  reduce %6.1f ms %5.1fx  transform %6.1f ms %5.1fx\n", threads,
+			find / 1e6, base_find / find, count / 1e6, base_count / count, reduce / 1e6, base_reduce / reduce, transform / 1e6, base_transform / transform);
+		if (threads == cores)
+			break;
+	}
+}
+
+template <class T>
+void sorting(const char* type)
+{
+	for (size_t size : { 10000, 1000000, 4000000 })
+	{
+		// shuffled values in a wrapped queue, copied into a fresh queue for every run
+		vector_queue<T> source;
+		source.reserve(size);
+		for (size_t i = 0; i < size; ++i)
+		{
+			size_t value = (i * 2654435761u) % size;
+			if constexpr (std::is_same_v<T, std::string>)
+				source.push_back(std::to_string(value));
+			else
+				source.push_back(T(value));
+		}
+		for (size_t i = 0; i < size / 3; ++i)
+		{
+			source.push_back(std::move(source.front()));
+			source.pop_front();
+		}
+		auto q = source;
+		std::vector<T> v(source.begin(), source.end());
+		auto vector_sort = measure([&] { std::copy(source.begin(), source.end(), v.begin()); std::sort(v.begin(), v.end()); }, 3);
+		auto iterator_sort = measure([&] { q = source; std::sort(q.begin(), q.end()); }, 3);
+		auto member_sort = measure([&] { q = source; q.sort(); }, 3);
+		auto parallel_sort = measure([&] { q = source; vq::sort(vq::par, q); }, 3);
+		std::printf("%-8s %9zu  std::sort vector %8.2f ms  std::sort iterators %8.2f ms  sort() %8.2f ms  vq::sort(par) %8.2f ms\n",
+			type, size, vector_sort / 1e6, iterator_sort / 1e6, member_sort / 1e6, parallel_sort / 1e6);
+	}
+}
+
+void bench_sort()
+{
+	sorting<int32_t>("int32_t");
+	sorting<double>("double");
+	sorting<std::string>("string");
+}
+
+// timestamps that mostly arrive a little late and once in a while a lot late, the earliest is popped regularly
+void bench_sorted()
+{
+	for (size_t size : { 1000, 100000, 1000000 })
+	{
+		std::vector<int64_t> timestamps(size * 4);
+		for (size_t i = 0; i < timestamps.size(); ++i)
+			timestamps[i] = int64_t(i) - int64_t((i * 2654435761u) % (i % 1000 == 0 ? size : 64));
+		auto run = [&](auto& container, auto pop)
+		{
+			for (size_t i = 0; i < size; ++i)
+				container.insert(timestamps[i]);
+			for (size_t i = size; i < timestamps.size(); ++i)
+			{
+				container.insert(timestamps[i]);
+				pop(container);
+			}
+			do_not_optimize(container.size());
+		};
+		auto set = measure([&]
+			{
+				std::multiset<int64_t> s;
+				run(s, [](auto& c) { c.erase(c.begin()); });
+			}, 3);
+		auto queue = measure([&]
+			{
+				sorted_vector_queue<int64_t> q;
+				run(q, [](auto& c) { c.pop_front(); });
+			}, 3);
+		std::printf("%9zu elements  std::multiset %8.2f ms  sorted_vector_queue %8.2f ms  %5.1fx\n", size, set / 1e6, queue / 1e6, set / queue);
+	}
+}
+
+// the latency of every single push_back into a queue growing to 4M elements
+template <class Queue>
+void push_latency(const char* name)
+{
+	constexpr size_t pushes = 1 << 22;
+	std::vector<float> latencies(pushes);
+	Queue q;
+	for (size_t i = 0; i < pushes; ++i)
+	{
+		auto start = std::chrono::steady_clock::now();
+		q.push_back(int64_t(i));
+		std::chrono::duration<float, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+		latencies[i] = elapsed.count();
+	}
+	do_not_optimize(q.back());
+	std::sort(latencies.begin(), latencies.end());
+	auto percentile = [&](double p) { return latencies[size_t(p * (pushes - 1))]; };
+	std::printf("%-26s p50 %8.0f ns  p99 %8.0f ns  p99.99 %10.0f ns  max %10.0f ns\n",
+		name, percentile(0.5), percentile(0.99), percentile(0.9999), latencies.back());
+}
+
+void bench_push_latency()
+{
+	push_latency<vector_queue<int64_t>>("vector_queue");
+	push_latency<incremental_vector_queue<int64_t>>("incremental_vector_queue");
+	push_latency<std::deque<int64_t>>("std::deque");
+}
+
+// push to the back, read every element by index and pop from the front
+template <class Queue>
+void fifo(const char* name)
+{
+	constexpr size_t size = 10000000;
+	Queue q;
+	auto push = measure([&] { q = Queue(); for (size_t i = 0; i < size; ++i) q.push_back(int32_t(i)); }, 3);
+	auto index = measure([&]
+		{
+			int32_t total = 0;
+			for (size_t i = 0; i < q.size(); ++i)
+				total += q[i];
+			do_not_optimize(total);
+		}, 3);
+	auto pop = measure([&] { while (!q.empty()) q.pop_front(); }, 1);
+	std::printf("%-20s push_back %7.2f ms  operator[] %7.2f ms  pop_front %7.2f ms\n", name, push / 1e6, index / 1e6, pop / 1e6);
+}
+
+void bench_blocks()
+{
+	fifo<vector_queue<int32_t>>("vector_queue");
+	fifo<block_vector_queue<int32_t>>("block_vector_queue");
+	fifo<block_vector_queue<int32_t, 64 * 1024>>("block size 64K");
+	fifo<std::deque<int32_t>>("std::deque");
+}
+
+// memory against indexing speed: the power of two policies wrap with a mask, the others with a compare
+template <class Policy>
+void growth(const char* name)
+{
+	constexpr size_t n = 3'000'000;
+	vector_queue<int32_t, std::allocator<int32_t>, Policy> q;
+	size_t peak = 0;
+	size_t reallocations = 0;
+	auto push = measure([&]
+		{
+			q = {};
+			peak = 0;
+			reallocations = 0;
+			for (size_t i = 0; i < n; ++i)
+			{
+				size_t capacity = q.capacity();
+				q.push_back(int32_t(i));
+				if (q.capacity() != capacity)
+				{
+					peak = std::max(peak, capacity + q.capacity());
+					++reallocations;
+				}
+			}
+		}, 3);
+	// rotate the queue so indexing wraps
+	for (size_t i = 0; i < n / 3; ++i)
+	{
+		q.push_back(q.front());
+		q.pop_front();
+	}
+	auto index = measure([&]
+		{
+			int32_t total = 0;
+			for (size_t i = 0; i < q.size(); ++i)
+				total += q[i];
+			do_not_optimize(total);
+		}, 5);
+	auto iterate = measure([&]
+		{
+			int32_t total = 0;
+			for (auto value : q)
+				total += value;
+			do_not_optimize(total);
+		}, 5);
+	std::printf("%-16s capacity %5.1f MB  peak %5.1f MB  %2zu grows  push_back %6.2f ms  operator[] %6.2f ms  iterate %6.2f ms\n", name,
+		q.capacity() * 4 / 1e6, peak * 4 / 1e6, reallocations, push / 1e6, index / 1e6, iterate / 1e6);
+}
+
+void bench_growth()
+{
+	growth<vq::double_growth>("double");
+	growth<vq::half_growth>("half");
+	growth<vq::page_growth<>>("page");
+	growth<vq::fixed_growth<256 * 1024>>("fixed 256K");
+}
+
+// the same capacity wrapped with a mask and with a compare and subtract
+template <class Policy>
+void wrapping(const char* name, const std::vector<uint32_t>& positions)
+{
+	constexpr size_t n = 1 << 20;
+	vector_queue<int32_t, std::allocator<int32_t>, Policy> q;
+	q.reserve(n);
+	// one slot free so rotating doesn't grow
+	for (size_t i = 0; i < n - 1; ++i)
+		q.push_back(int32_t(i));
+	for (size_t i = 0; i < n / 3; ++i)
+	{
+		q.push_back(q.front());
+		q.pop_front();
+	}
+	auto index = measure([&]
+		{
+			int32_t total = 0;
+			for (size_t i = 0; i < q.size(); ++i)
+				total += q[i];
+			do_not_optimize(total);
+		});
+	auto random = measure([&]
+		{
+			int32_t total = 0;
+			for (auto position : positions)
+				total += q[position];
+			do_not_optimize(total);
+		});
+	auto ring = measure([&]
+		{
+			for (size_t i = 0; i < n; ++i)
+			{
+				q.push_back(q.front());
+				q.pop_front();
+			}
+		});
+	auto find = measure([&] { do_not_optimize(q.find(-1)); });
+	std::printf("%-8s capacity %zu  operator[] %6.2f ms  random operator[] %6.2f ms  push_back/pop_front %6.2f ms  find %6.2f ms\n", name,
+		q.capacity(), index / 1e6, random / 1e6, ring / 1e6, find / 1e6);
+}
+
+void bench_wrapping()
+{
+	std::vector<uint32_t> positions(1 << 20);
+	uint32_t seed = 1;
+	for (auto& position : positions)
+	{
+		seed = seed * 1664525 + 1013904223;
+		position = (seed >> 8) % ((1 << 20) - 1);
+	}
+	wrapping<vq::double_growth>("mask", positions);
+	wrapping<vq::exact_growth>("compare", positions);
+}
+
+// many queues take a burst and go back to a trickle, how much memory they keep and what the cycles cost
+template <class Policy>
+void bursts(const char* name)
+{
+	std::vector<vector_queue<int64_t, std::allocator<int64_t>, Policy>> queues(1000);
+	size_t capacity = 0;
+	auto cycles = measure([&]
+		{
+			for (auto& q : queues)
+			{
+				for (int i = 0; i < 4096; ++i)
+					q.push_back(i);
+				while (q.size() > 8)
+					q.pop_front();
+				for (int i = 0; i < 1000; ++i)
+				{
+					q.push_back(i);
+					q.pop_front();
+				}
+			}
+			capacity = 0;
+			for (auto& q : queues)
+				capacity += q.capacity();
+		}, 3);
+	std::printf("%-20s burst, drain and trickle %7.2f ms  capacity after %6.2f MB\n", name, cycles / 1e6, capacity * 8 / 1e6);
+}
+
+void bench_bursts()
+{
+	bursts<vq::double_growth>("double_growth");
+	bursts<vq::shrink_after_bursts<>>("shrink_after_bursts");
+}
+
+// a tick over an array of mostly empty queues, the compact header fits four queues in a cache line
+template <class Queue>
+void headers(const char* name)
+{
+	std::vector<Queue> queues(2'000'000);
+	for (size_t i = 0; i < queues.size(); i += 16)
+		queues[i].push_back(int32_t(i));
+	auto tick = measure([&]
+		{
+			int64_t total = 0;
+			for (auto& q : queues)
+				if (!q.empty())
+					total += q.front();
+			do_not_optimize(total);
+		});
+	std::printf("%-24s %2zu bytes  tick %6.2f ms\n", name, sizeof(Queue), tick / 1e6);
+}
+
+void bench_headers()
+{
+	headers<vector_queue<int32_t>>("vector_queue");
+	headers<vector_queue<int32_t, std::allocator<int32_t>, vq::double_growth, uint32_t>>("uint32_t SizeType");
+}
+
+// short lived queues, each grows through a few capacities before it is destroyed
+template <class Alloc>
+double churn()
+{
+	return measure([]
+		{
+			for (int round = 0; round < 100'000; ++round)
+			{
+				vector_queue<int32_t, Alloc> q;
+				for (int i = 0; i < 100 + round % 200; ++i)
+					q.push_back(i);
+				do_not_optimize(q.back());
+			}
+		}, 3);
+}
+
+void bench_churn()
+{
+	std::printf("std::allocator          %7.2f ms\n", churn<std::allocator<int32_t>>() / 1e6);
+	auto before = size_class_allocator<int32_t>::stats();
+	auto cached = churn<size_class_allocator<int32_t>>();
+	auto after = size_class_allocator<int32_t>::stats();
+	double hits = double(after.hits - before.hits);
+	double misses = double(after.misses - before.misses);
+	std::printf("size_class_allocator    %7.2f ms  hit rate %.4f\n", cached / 1e6, hits / (hits + misses));
+}
+
+// per request queues from the heap, or from a monotonic arena that is released in one go after the request
+void bench_pmr()
+{
+	auto request = [](auto make)
+	{
+		for (int round = 0; round < 20'000; ++round)
+		{
+			auto queues = make();
+			for (auto& q : queues)
+				for (int i = 0; i < 100; ++i)
+					q.push_back(i);
+			do_not_optimize(queues.back().back());
+		}
+	};
+	auto heap = measure([&]
+		{
+			request([] { return std::vector<vector_queue<int32_t>>(16); });
+		}, 3);
+	std::vector<std::byte> storage(1 << 20);
+	auto arena = measure([&]
+		{
+			std::pmr::monotonic_buffer_resource resource(storage.data(), storage.size());
+			request([&]
+				{
+					resource.release();
+					return std::pmr::vector<vq::pmr::vector_queue<int32_t>>(16, &resource);
+				});
+		}, 3);
+	std::printf("std::allocator            %7.2f ms\nmonotonic_buffer_resource %7.2f ms\n", heap / 1e6, arena / 1e6);
+}
+
+// one small queue per connection, filled and then served round robin
+template <class Queue>
+double connections(std::vector<Queue>& queues)
+{
+	return measure([&]
+		{
+			for (size_t i = 0; i < queues.size(); ++i)
+				for (size_t j = 0; j < 8 + i % 24; ++j)
+					queues[i].push_back(int32_t(j));
+			for (int round = 0; round < 8; ++round)
+				for (auto& q : queues)
+				{
+					q.push_back(q.front());
+					q.pop_front();
+				}
+			int64_t total = 0;
+			for (auto& q : queues)
+				total += q.sum();
+			do_not_optimize(total);
+			for (auto& q : queues)
+			{
+				q.clear();
+				q.shrink_to_fit();
+			}
+		}, 3);
+}
+
+void bench_pool()
+{
+	std::vector<vector_queue<int32_t>> heap(100'000);
+	std::printf("std::allocator     %7.2f ms\n", connections(heap) / 1e6);
+	vector_queue_pool pool;
+	std::vector<vector_queue_pool::queue<int32_t>> pooled;
+	for (int i = 0; i < 100'000; ++i)
+		pooled.push_back(pool.make_queue<int32_t>());
+	auto time = connections(pooled);
+	for (size_t i = 0; i < pooled.size(); ++i)
+		for (size_t j = 0; j < 8 + i % 24; ++j)
+			pooled[i].push_back(int32_t(j));
+	std::printf("vector_queue_pool  %7.2f ms  %.1f MB in use in %.1f MB of slabs", time / 1e6, pool.used_bytes() / 1e6, pool.reserved_bytes() / 1e6);
+	// three of four queues go away, the rest move together
+	for (size_t i = 0; i < pooled.size(); ++i)
+		if (i % 4 != 0)
+			pooled[i] = pool.make_queue<int32_t>();
+	std::printf(", compact(queues) released %zu slabs", pool.compact(pooled));
+	pooled.clear();
+	std::printf(", compact() %zu more\n", pool.compact());
+}
+
+// scans and random reads over a 256 MB queue, the huge pages cut the TLB misses
+template <class Alloc>
+void large_scan(const char* name)
+{
+	vector_queue<int32_t, Alloc> q;
+	for (int32_t i = 0; i < (1 << 26) - 1; ++i)
+		q.push_back(i);
+	auto find = measure([&] { do_not_optimize(q.find(-1)); }, 5);
+	auto random = measure([&]
+		{
+			uint32_t seed = 1;
+			int32_t total = 0;
+			for (int i = 0; i < 1'000'000; ++i)
+			{
+				seed = seed * 1664525 + 1013904223;
+				total += q[seed % q.size()];
+			}
+			do_not_optimize(total);
+		}, 5);
+	std::printf("%-20s find %7.2f ms  random operator[] %7.2f ms\n", name, find / 1e6, random / 1e6);
+}
+
+void bench_huge_pages()
+{
+	large_scan<std::allocator<int32_t>>("std::allocator");
+	large_scan<huge_page_allocator<int32_t>>("huge_page_allocator");
+}
+
+int main(int argc, char** argv)
+{
+	std::pair<const char*, std::function<void()>> benchmarks[] = {
+		{ "reductions", bench_reductions },
+		{ "iteration", bench_iteration },
+		{ "parallel", bench_parallel },
+		{ "sort", bench_sort },
+		{ "sorted", bench_sorted },
+		{ "push_latency", bench_push_latency },
+		{ "blocks", bench_blocks },
+		{ "growth", bench_growth },
+		{ "wrapping", bench_wrapping },
+		{ "bursts", bench_bursts },
+		{ "headers", bench_headers },
+		{ "churn", bench_churn },
+		{ "pmr", bench_pmr },
+		{ "pool", bench_pool },
+		{ "huge_pages", bench_huge_pages },
+	};
+	for (auto& [name, run] : benchmarks)
+	{
+		bool selected = argc == 1;
+		for (int i = 1; i < argc; ++i)
+			selected |= std::strcmp(argv[i], name) == 0;
+		if (selected)
+		{
+			std::printf("== %s\n", name);
+			run();
+		}
+	}
+}
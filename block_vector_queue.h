@@ -0,0 +1,312 @@
+#pragma once
+/*
+Copyright (c) 2021 Christian Olsson
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#include <bit>
+#include <compare>
+#include <cstddef>
+#include <iterator>
+#include <utility>
+#include "vector_queue.h"
+
+namespace vq::detail
+{
+	// elements per block of a block_vector_queue, enough for at least 4 KB
+	template <class T>
+	constexpr size_t default_block_size = std::bit_ceil(std::max<size_t>(16, 4096 / sizeof(T)));
+}
+
+// A double ended queue that stores its elements in fixed size blocks, so elements never move and
+// references stay valid until the element is popped. The blocks are listed in a vector_queue of
+// pointers and an index is split into a block and an offset with a shift and a mask.
+// BlockSize is the number of elements per block and has to be a power of two, the default
+// makes the blocks at least 4 KB.
+template <class T, size_t BlockSize = vq::detail::default_block_size<T>, class Alloc = std::allocator<T>>
+class block_vector_queue
+{
+	static_assert(std::has_single_bit(BlockSize), "BlockSize has to be a power of two");
+	static constexpr size_t block_shift = std::countr_zero(BlockSize);
+	using traits = std::allocator_traits<Alloc>;
+	using map_type = vector_queue<T*, typename traits::template rebind_alloc<T*>>;
+
+public:
+	using value_type = T;
+	using reference = T&;
+	using const_reference = const T&;
+	using difference_type = ptrdiff_t;
+	using allocator_type = Alloc;
+	static constexpr size_t block_size = BlockSize;
+
+	template <class V>
+	struct iter_templ
+	{
+		typedef ptrdiff_t difference_type;
+		typedef T value_type;
+		typedef V* pointer;
+		typedef V& reference;
+		typedef std::random_access_iterator_tag iterator_category;
+		using container_type = std::conditional_t<std::is_const_v<V>, const block_vector_queue, block_vector_queue>;
+
+		V& operator*() const { return (*container)[index]; }
+		V* operator->() const { return &(*container)[index]; }
+		V& operator[](ptrdiff_t diff) const { return (*container)[index + diff]; }
+
+		iter_templ& operator++() { ++index; return *this; }
+		iter_templ operator++(int) { auto tmp = *this; ++index; return tmp; }
+		iter_templ& operator--() { --index; return *this; }
+		iter_templ operator--(int) { auto tmp = *this; --index; return tmp; }
+		iter_templ& operator+=(ptrdiff_t diff) { index += diff; return *this; }
+		iter_templ& operator-=(ptrdiff_t diff) { index -= diff; return *this; }
+		iter_templ operator+(ptrdiff_t diff) const { return { index + diff, container }; }
+		iter_templ operator-(ptrdiff_t diff) const { return { index - diff, container }; }
+		friend iter_templ operator+(ptrdiff_t diff, const iter_templ& it) { return it + diff; }
+		ptrdiff_t operator-(const iter_templ& other) const { return ptrdiff_t(index - other.index); }
+		bool operator==(const iter_templ& other) const { return index == other.index; }
+		std::strong_ordering operator<=>(const iter_templ& other) const { return index <=> other.index; }
+
+		operator iter_templ<const T>() const
+		{
+			return { index, container };
+		}
+
+		size_t index = 0;
+		container_type* container = nullptr;
+	};
+
+	using iterator = iter_templ<T>;
+	using const_iterator = iter_templ<const T>;
+
+	block_vector_queue() = default;
+	explicit block_vector_queue(const Alloc& alloc) : map(typename map_type::allocator_type(alloc)), alloc(alloc)
+	{}
+
+	block_vector_queue(block_vector_queue&& other) noexcept : map(std::move(other.map)), spare(other.spare), start(other.start),
+		_size(other._size), alloc(other.alloc)
+	{
+		other.spare = nullptr;
+		other.start = 0;
+		other._size = 0;
+	}
+
+	block_vector_queue& operator=(block_vector_queue&& other) noexcept
+	{
+		swap(other);
+		return *this;
+	}
+
+	block_vector_queue(const block_vector_queue&) = delete;
+	block_vector_queue& operator=(const block_vector_queue&) = delete;
+
+	~block_vector_queue()
+	{
+		clear();
+		release_spare();
+	}
+
+	iterator begin() { return { 0, this }; }
+	iterator end() { return { _size, this }; }
+	const_iterator begin() const { return { 0, this }; }
+	const_iterator end() const { return { _size, this }; }
+	const_iterator cbegin() const { return { 0, this }; }
+	const_iterator cend() const { return { _size, this }; }
+
+	T& operator[](size_t index)
+	{
+		size_t position = start + index;
+		return map[position >> block_shift][position & (BlockSize - 1)];
+	}
+
+	const T& operator[](size_t index) const
+	{
+		size_t position = start + index;
+		return map[position >> block_shift][position & (BlockSize - 1)];
+	}
+
+	T& front() { return (*this)[0]; }
+	const T& front() const { return (*this)[0]; }
+	T& back() { return (*this)[_size - 1]; }
+	const T& back() const { return (*this)[_size - 1]; }
+
+	size_t size() const
+	{
+		return _size;
+	}
+
+	bool empty() const
+	{
+		return _size == 0;
+	}
+
+	// number of blocks in use
+	size_t blocks() const
+	{
+		return map.size();
+	}
+
+	template <class... Args>
+	T& emplace_back(Args&&... args)
+	{
+		size_t position = start + _size;
+		if (position == map.size() * BlockSize)
+			map.push_back(take_block());
+		T* slot = &map[position >> block_shift][position & (BlockSize - 1)];
+#ifndef VECTOR_QUEUE_NO_EXCEPTIONS
+		try {
+#endif
+			std::construct_at(slot, std::forward<Args>(args)...);
+#ifndef VECTOR_QUEUE_NO_EXCEPTIONS
+		}
+		catch (...)
+		{
+			if ((position & (BlockSize - 1)) == 0)
+				drop_block_back();
+			throw;
+		}
+#endif
+		++_size;
+		return *slot;
+	}
+
+	void push_back(const T& value)
+	{
+		emplace_back(value);
+	}
+
+	void push_back(T&& value)
+	{
+		emplace_back(std::move(value));
+	}
+
+	template <class... Args>
+	T& emplace_front(Args&&... args)
+	{
+		bool new_block = start == 0;
+		if (new_block)
+		{
+			map.push_front(take_block());
+			start = BlockSize;
+		}
+		T* slot = &map.front()[start - 1];
+#ifndef VECTOR_QUEUE_NO_EXCEPTIONS
+		try {
+#endif
+			std::construct_at(slot, std::forward<Args>(args)...);
+#ifndef VECTOR_QUEUE_NO_EXCEPTIONS
+		}
+		catch (...)
+		{
+			if (new_block)
+				drop_block_front();
+			throw;
+		}
+#endif
+		--start;
+		++_size;
+		return *slot;
+	}
+
+	void push_front(const T& value)
+	{
+		emplace_front(value);
+	}
+
+	void push_front(T&& value)
+	{
+		emplace_front(std::move(value));
+	}
+
+	void pop_front()
+	{
+		std::destroy_at(&front());
+		++start;
+		--_size;
+		if (start == BlockSize || _size == 0)
+			drop_block_front();
+	}
+
+	void pop_back()
+	{
+		std::destroy_at(&back());
+		--_size;
+		if (((start + _size) & (BlockSize - 1)) == 0 || _size == 0)
+			drop_block_back();
+	}
+
+	void clear()
+	{
+		while (!empty())
+			pop_back();
+	}
+
+	void swap(block_vector_queue& other) noexcept
+	{
+		map.swap(other.map);
+		std::swap(spare, other.spare);
+		std::swap(start, other.start);
+		std::swap(_size, other._size);
+		std::swap(alloc, other.alloc);
+	}
+
+private:
+	// one empty block is kept so a queue going back and forth over a block boundary doesn't allocate
+	T* take_block()
+	{
+		if (spare)
+			return std::exchange(spare, nullptr);
+		return traits::allocate(alloc, BlockSize);
+	}
+
+	void give_block(T* block)
+	{
+		if (spare)
+			traits::deallocate(alloc, spare, BlockSize);
+		spare = block;
+	}
+
+	void drop_block_front()
+	{
+		give_block(map.front());
+		map.pop_front();
+		start = 0;
+	}
+
+	void drop_block_back()
+	{
+		give_block(map.back());
+		map.pop_back();
+		if (map.empty())
+			start = 0;
+	}
+
+	void release_spare()
+	{
+		if (spare)
+			traits::deallocate(alloc, std::exchange(spare, nullptr), BlockSize);
+	}
+
+	map_type map;
+	T* spare = nullptr;
+	size_t start = 0; // offset of the front element in the first block
+	size_t _size = 0;
+	[[no_unique_address]] Alloc alloc;
+};
@@ -0,0 +1,130 @@
+#pragma once
+/*
+Copyright (c) 2021 Christian Olsson
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <limits>
+#include <new>
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
+// An allocator for large queues. Buffers of at least Threshold bytes are rounded up to whole 2 MB
+// pages, aligned to 2 MB and on Linux mapped with madvise(MADV_HUGEPAGE) so transparent huge pages
+// back them and a scan over the queue takes far fewer TLB misses. With HugeTLB they are first tried
+// with MAP_HUGETLB from the reserved huge pages, falling back when none are free. Smaller buffers
+// are aligned to Alignment bytes, a cache line by default.
+template <class T, size_t Threshold = size_t(1) << 21, size_t Alignment = 64, bool HugeTLB = false>
+struct huge_page_allocator
+{
+	static_assert(std::has_single_bit(Alignment) && Alignment >= alignof(T), "Alignment has to be a power of two of at least alignof(T)");
+	static constexpr size_t huge_page_size = size_t(1) << 21;
+
+	using value_type = T;
+	template <class U>
+	struct rebind
+	{
+		using other = huge_page_allocator<U, Threshold, Alignment, HugeTLB>;
+	};
+
+	huge_page_allocator() = default;
+	template <class U>
+	huge_page_allocator(const huge_page_allocator<U, Threshold, Alignment, HugeTLB>&) noexcept {}
+
+	T* allocate(size_t n)
+	{
+		if (n > (std::numeric_limits<size_t>::max() - huge_page_size) / sizeof(T))
+			fail();
+		size_t bytes = n * sizeof(T);
+		if (bytes >= Threshold)
+			return static_cast<T*>(allocate_huge(huge_bytes(bytes)));
+		return static_cast<T*>(::operator new(bytes, std::align_val_t(Alignment)));
+	}
+
+	void deallocate(T* buffer, size_t n) noexcept
+	{
+		size_t bytes = n * sizeof(T);
+		if (bytes >= Threshold)
+			deallocate_huge(buffer, huge_bytes(bytes));
+		else
+			::operator delete(buffer, bytes, std::align_val_t(Alignment));
+	}
+
+	friend bool operator==(const huge_page_allocator&, const huge_page_allocator&) noexcept
+	{
+		return true;
+	}
+
+private:
+	static size_t huge_bytes(size_t bytes)
+	{
+		return (bytes + huge_page_size - 1) & ~(huge_page_size - 1);
+	}
+
+	[[noreturn]] static void fail()
+	{
+#ifndef VECTOR_QUEUE_NO_EXCEPTIONS
+		throw std::bad_alloc();
+#else
+		std::abort();
+#endif
+	}
+
+	static void* allocate_huge(size_t bytes)
+	{
+#ifdef __linux__
+		if constexpr (HugeTLB)
+		{
+			void* mapped = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+			if (mapped != MAP_FAILED)
+				return mapped;
+		}
+		// map an extra huge page and unmap what is around the aligned part
+		void* mapped = mmap(nullptr, bytes + huge_page_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (mapped == MAP_FAILED)
+			fail();
+		auto address = reinterpret_cast<uintptr_t>(mapped);
+		auto aligned = (address + huge_page_size - 1) & ~(huge_page_size - 1);
+		if (aligned != address)
+			munmap(mapped, aligned - address);
+		if (size_t tail = huge_page_size - (aligned - address))
+			munmap(reinterpret_cast<void*>(aligned + bytes), tail);
+		madvise(reinterpret_cast<void*>(aligned), bytes, MADV_HUGEPAGE);
+		return reinterpret_cast<void*>(aligned);
+#else
+		return ::operator new(bytes, std::align_val_t(huge_page_size));
+#endif
+	}
+
+	static void deallocate_huge(void* buffer, size_t bytes) noexcept
+	{
+#ifdef __linux__
+		munmap(buffer, bytes);
+#else
+		::operator delete(buffer, bytes, std::align_val_t(huge_page_size));
+#endif
+	}
+};
@@ -0,0 +1,258 @@
+#pragma once
+/*
+Copyright (c) 2021 Christian Olsson
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#include <compare>
+#include <cstddef>
+#include <iterator>
+#include "vector_queue.h"
+
+// A double ended queue that grows without moving all elements at once. When the buffer is full
+// a buffer twice as large is allocated and the elements move over a few at a time on the following
+// pushes and pops, so no single operation moves more than migrate_step elements.
+// The elements are the ones in the old buffer followed by the ones in the new buffer, elements
+// migrate from the back of the old buffer to the front of the new one. Freeing a large buffer can
+// take longer than moving all of its elements did, so the emptied old buffers are kept, together
+// smaller than the current one, until release_retired() or clear().
+template <class T, class Alloc = std::allocator<T>>
+class incremental_vector_queue
+{
+public:
+	using queue_type = vector_queue<T, Alloc>;
+	using retired_type = vector_queue<queue_type, typename std::allocator_traits<Alloc>::template rebind_alloc<queue_type>>;
+	using value_type = T;
+	using reference = T&;
+	using const_reference = const T&;
+	using difference_type = ptrdiff_t;
+
+	// elements moved per operation while migrating, enough that the new buffer can't fill up first
+	static constexpr size_t migrate_step = 4;
+
+	template <class V>
+	struct iter_templ
+	{
+		typedef ptrdiff_t difference_type;
+		typedef T value_type;
+		typedef V* pointer;
+		typedef V& reference;
+		typedef std::random_access_iterator_tag iterator_category;
+		using container_type = std::conditional_t<std::is_const_v<V>, const incremental_vector_queue, incremental_vector_queue>;
+
+		V& operator*() const { return (*container)[index]; }
+		V* operator->() const { return &(*container)[index]; }
+		V& operator[](ptrdiff_t diff) const { return (*container)[index + diff]; }
+
+		iter_templ& operator++() { ++index; return *this; }
+		iter_templ operator++(int) { auto tmp = *this; ++index; return tmp; }
+		iter_templ& operator--() { --index; return *this; }
+		iter_templ operator--(int) { auto tmp = *this; --index; return tmp; }
+		iter_templ& operator+=(ptrdiff_t diff) { index += diff; return *this; }
+		iter_templ& operator-=(ptrdiff_t diff) { index -= diff; return *this; }
+		iter_templ operator+(ptrdiff_t diff) const { return { index + diff, container }; }
+		iter_templ operator-(ptrdiff_t diff) const { return { index - diff, container }; }
+		friend iter_templ operator+(ptrdiff_t diff, const iter_templ& it) { return it + diff; }
+		ptrdiff_t operator-(const iter_templ& other) const { return ptrdiff_t(index - other.index); }
+		bool operator==(const iter_templ& other) const { return index == other.index; }
+		std::strong_ordering operator<=>(const iter_templ& other) const { return index <=> other.index; }
+
+		operator iter_templ<const T>() const
+		{
+			return { index, container };
+		}
+
+		size_t index = 0;
+		container_type* container = nullptr;
+	};
+
+	using iterator = iter_templ<T>;
+	using const_iterator = iter_templ<const T>;
+
+	incremental_vector_queue() = default;
+	explicit incremental_vector_queue(const Alloc& alloc) : old(alloc), cur(alloc), retired(typename retired_type::allocator_type(alloc))
+	{}
+
+	iterator begin() { return { 0, this }; }
+	iterator end() { return { size(), this }; }
+	const_iterator begin() const { return { 0, this }; }
+	const_iterator end() const { return { size(), this }; }
+	const_iterator cbegin() const { return { 0, this }; }
+	const_iterator cend() const { return { size(), this }; }
+
+	T& operator[](size_t index)
+	{
+		return index < old.size() ? old[index] : cur[index - old.size()];
+	}
+
+	const T& operator[](size_t index) const
+	{
+		return index < old.size() ? old[index] : cur[index - old.size()];
+	}
+
+	T& front()
+	{
+		return old.empty() ? cur.front() : old.front();
+	}
+
+	const T& front() const
+	{
+		return old.empty() ? cur.front() : old.front();
+	}
+
+	T& back()
+	{
+		return cur.empty() ? old.back() : cur.back();
+	}
+
+	const T& back() const
+	{
+		return cur.empty() ? old.back() : cur.back();
+	}
+
+	size_t size() const
+	{
+		return old.size() + cur.size();
+	}
+
+	bool empty() const
+	{
+		return size() == 0;
+	}
+
+	// true while elements are left in the old buffer
+	bool migrating() const
+	{
+		return !old.empty();
+	}
+
+	// the element is added before migrating so args can refer to an element of the queue
+	template <class... Args>
+	void emplace_back(Args&&... args)
+	{
+		if (cur.size() == cur.capacity() && cur.capacity() != 0)
+			start_migration();
+		cur.emplace_back(std::forward<Args>(args)...);
+		migrate();
+	}
+
+	void push_back(const T& value)
+	{
+		emplace_back(value);
+	}
+
+	void push_back(T&& value)
+	{
+		emplace_back(std::move(value));
+	}
+
+	// goes to the front of the old buffer while migrating, after making room by migrating
+	template <class... Args>
+	void emplace_front(Args&&... args)
+	{
+		if (!migrating() && (cur.size() < cur.capacity() || cur.capacity() == 0))
+		{
+			cur.emplace_front(std::forward<Args>(args)...);
+			return;
+		}
+		T value(std::forward<Args>(args)...);
+		if (!migrating())
+			start_migration();
+		migrate();
+		if (migrating())
+			old.emplace_front(std::move(value));
+		else
+			cur.emplace_front(std::move(value));
+	}
+
+	void push_front(const T& value)
+	{
+		emplace_front(value);
+	}
+
+	void push_front(T&& value)
+	{
+		emplace_front(std::move(value));
+	}
+
+	void pop_front()
+	{
+		if (migrating())
+			old.pop_front();
+		else
+			cur.pop_front();
+		migrate();
+	}
+
+	void pop_back()
+	{
+		if (cur.empty())
+			old.pop_back();
+		else
+			cur.pop_back();
+		migrate();
+	}
+
+	void clear()
+	{
+		old = queue_type(old.get_allocator());
+		cur.clear();
+		release_retired();
+	}
+
+	// free the buffers emptied by earlier migrations, returns how many
+	size_t release_retired()
+	{
+		size_t released = retired.size();
+		retired.clear();
+		return released;
+	}
+
+	// move the remaining elements now
+	void finish_migration()
+	{
+		while (migrating())
+			migrate();
+	}
+
+private:
+	void start_migration()
+	{
+		old.swap(cur);
+		cur.reserve(old.capacity() * 2);
+	}
+
+	// also retires the old buffer once it's empty, whether migrated or popped
+	void migrate()
+	{
+		for (size_t i = 0; i < migrate_step && !old.empty(); ++i)
+		{
+			cur.emplace_front(std::move(old.back()));
+			old.pop_back();
+		}
+		if (old.empty() && old.capacity() != 0)
+			retired.push_back(std::move(old));
+	}
+
+	queue_type old;
+	queue_type cur;
+	retired_type retired;
+};
@@ -0,0 +1,170 @@
+#pragma once
+/*
+Copyright (c) 2021 Christian Olsson
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include "vector_queue.h"
+
+struct record_queue_unit
+{
+	alignas(8) std::byte bytes[8];
+};
+
+// A queue of variable length byte records stored inline in a growable ring.
+// Every record is a one unit header holding the payload length followed by the payload rounded up to whole
+// units, so payloads are 8 byte aligned. A record that would straddle the end of the ring is placed at the
+// start of the ring instead and the skipped units are covered by a padding record.
+template <class Alloc = std::allocator<record_queue_unit>>
+class record_queue
+{
+public:
+	using unit = record_queue_unit;
+	using allocator_type = typename std::allocator_traits<Alloc>::template rebind_alloc<unit>;
+	using ring_type = vector_queue<unit, allocator_type>;
+
+	record_queue() = default;
+	explicit record_queue(const allocator_type& alloc) : ring(alloc)
+	{}
+
+	void push(std::span<const std::byte> record)
+	{
+		auto payload = emplace(record.size());
+		if (!record.empty())
+			std::memcpy(payload.data(), record.data(), record.size());
+	}
+
+	// append a record of the given size and return its payload for the caller to fill in
+	std::span<std::byte> emplace(size_t size)
+	{
+		size_t units = units_for(size);
+		if (ring.empty())
+			ring.set_start(0);
+		size_t back = ring.wrap_up(ring.size());
+		if (ring.size() == ring.capacity() || (back >= ring.start() && units > ring.capacity() - back && units > ring.start())
+			|| (back < ring.start() && units > ring.start() - back))
+		{
+			ring.reserve(std::max(ring.size() + units, ring.next_capacity()));
+			back = ring.size();
+		}
+		else if (back >= ring.start() && units > ring.capacity() - back)
+		{
+			// does not fit before the end of the ring, skip to the beginning
+			write_header(back, (ring.capacity() - back - 1) * sizeof(unit) | padding_flag);
+			ring._size += ring.capacity() - back;
+			back = 0;
+		}
+		write_header(back, size);
+		ring._size += units;
+		++count;
+		return { payload(back), size };
+	}
+
+	std::span<std::byte> front()
+	{
+		return { payload(ring.start()), size_t(read_header(ring.start())) };
+	}
+
+	std::span<const std::byte> front() const
+	{
+		return { payload(ring.start()), size_t(read_header(ring.start())) };
+	}
+
+	void pop()
+	{
+		drop_front();
+		--count;
+		// keep the invariant that the front is never padding
+		while (!ring.empty() && (read_header(ring.start()) & padding_flag))
+			drop_front();
+	}
+
+	void clear()
+	{
+		ring.clear();
+		count = 0;
+	}
+
+	void reserve(size_t bytes)
+	{
+		ring.reserve((bytes + sizeof(unit) - 1) / sizeof(unit));
+	}
+
+	// number of records
+	size_t size() const
+	{
+		return count;
+	}
+
+	bool empty() const
+	{
+		return count == 0;
+	}
+
+	// number of bytes used by records, headers and padding
+	size_t bytes() const
+	{
+		return ring.size() * sizeof(unit);
+	}
+
+	size_t capacity_bytes() const
+	{
+		return ring.capacity() * sizeof(unit);
+	}
+
+private:
+	static constexpr uint64_t padding_flag = uint64_t(1) << 63;
+
+	static constexpr size_t units_for(size_t size)
+	{
+		return 1 + (size + sizeof(unit) - 1) / sizeof(unit);
+	}
+
+	std::byte* payload(size_t index) const
+	{
+		return reinterpret_cast<std::byte*>(ring.array + index + 1);
+	}
+
+	void write_header(size_t index, uint64_t header)
+	{
+		std::memcpy(ring.array[index].bytes, &header, sizeof(header));
+	}
+
+	uint64_t read_header(size_t index) const
+	{
+		uint64_t header;
+		std::memcpy(&header, ring.array[index].bytes, sizeof(header));
+		return header;
+	}
+
+	void drop_front()
+	{
+		auto units = units_for(size_t(read_header(ring.start()) & ~padding_flag));
+		ring.set_start(ring.wrap_up(units));
+		ring._size -= units;
+	}
+
+	ring_type ring;
+	size_t count = 0;
+};
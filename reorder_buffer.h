@@ -0,0 +1,197 @@
+#pragma once
+/*
+Copyright (c) 2021 Christian Olsson
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <bit>
+#include <cstdint>
+#include <optional>
+#include "vector_queue.h"
+
+// Releases values inserted out of order in sequence order.
+// Slot i holds the value for sequence number base_seq() + i and a bitmap of filled slots, aligned to
+// 64 sequence numbers, lets pop_ready() find the ready prefix a word at a time. Values more than
+// max_window sequence numbers ahead of base_seq() are rejected, so a bogus sequence number can't
+// make the buffer allocate a slot for every number in between.
+template <class T, class Alloc = std::allocator<T>>
+class reorder_buffer
+{
+public:
+	using value_type = T;
+	using slot_allocator = typename std::allocator_traits<Alloc>::template rebind_alloc<std::optional<T>>;
+	using bitmap_allocator = typename std::allocator_traits<Alloc>::template rebind_alloc<uint64_t>;
+
+	static constexpr size_t default_max_window = size_t(1) << 20;
+
+	explicit reorder_buffer(uint64_t first_seq = 0, size_t max_window = default_max_window) : base(first_seq), window(max_window)
+	{}
+
+	reorder_buffer(uint64_t first_seq, const Alloc& alloc) : reorder_buffer(first_seq, default_max_window, alloc)
+	{}
+
+	reorder_buffer(uint64_t first_seq, size_t max_window, const Alloc& alloc)
+		: slots(slot_allocator(alloc)), filled(bitmap_allocator(alloc)), base(first_seq), window(max_window)
+	{}
+
+	// returns false if seq has already been released, is already in the buffer or is max_window()
+	// or more ahead of base_seq()
+	template <class... Args>
+	bool emplace_at_seq(uint64_t seq, Args&&... args)
+	{
+		if (seq < base || seq - base >= window)
+			return false;
+		size_t offset = size_t(seq - base);
+		if (offset < slots.size() && slots[offset])
+			return false;
+		if (slots.size() <= offset)
+		{
+			// the holes up to offset, with one allocation
+			slots.reserve(offset + 1);
+			while (slots.size() <= offset)
+				slots.emplace_back();
+			size_t words = (bit_offset() + slots.size() + 63) / 64;
+			filled.reserve(words);
+			while (filled.size() < words)
+				filled.push_back(0);
+		}
+		slots[offset].emplace(std::forward<Args>(args)...);
+		size_t bit = bit_offset() + offset;
+		filled[bit / 64] |= uint64_t(1) << (bit % 64);
+		return true;
+	}
+
+	bool insert_at_seq(uint64_t seq, const T& value)
+	{
+		return emplace_at_seq(seq, value);
+	}
+
+	bool insert_at_seq(uint64_t seq, T&& value)
+	{
+		return emplace_at_seq(seq, std::move(value));
+	}
+
+	// number of values that can be released in sequence right now
+	size_t ready() const
+	{
+		size_t count = 0;
+		size_t bit = bit_offset();
+		for (size_t w = 0; w < filled.size(); ++w)
+		{
+			auto run = size_t(std::countr_zero(~(filled[w] >> bit)));
+			count += run;
+			if (bit + run < 64)
+				break;
+			bit = 0;
+		}
+		return count;
+	}
+
+	// call f with every value in the filled prefix, in sequence order, and release them
+	template <class F>
+	size_t pop_ready(F&& f)
+	{
+		size_t n = ready();
+		for (size_t i = 0; i < n; ++i)
+		{
+			f(std::move(*slots.front()));
+			pop_slot();
+		}
+		return n;
+	}
+
+	// give up on everything before seq, holes and values alike
+	void skip_to(uint64_t seq)
+	{
+		while (base < seq && !slots.empty())
+			pop_slot();
+		if (base < seq)
+		{
+			base = seq;
+			filled.clear();
+		}
+	}
+
+	bool contains(uint64_t seq) const
+	{
+		return seq >= base && seq - base < slots.size() && slots[size_t(seq - base)].has_value();
+	}
+
+	T* at_seq(uint64_t seq)
+	{
+		if (!contains(seq))
+			return nullptr;
+		return &*slots[size_t(seq - base)];
+	}
+
+	const T* at_seq(uint64_t seq) const
+	{
+		if (!contains(seq))
+			return nullptr;
+		return &*slots[size_t(seq - base)];
+	}
+
+	// the next sequence number to be released
+	uint64_t base_seq() const
+	{
+		return base;
+	}
+
+	// how far ahead of base_seq() a value can be
+	size_t max_window() const
+	{
+		return window;
+	}
+
+	// number of slots, filled or not
+	size_t size() const
+	{
+		return slots.size();
+	}
+
+	bool empty() const
+	{
+		return slots.empty();
+	}
+
+	void clear()
+	{
+		skip_to(base + slots.size());
+	}
+
+private:
+	size_t bit_offset() const
+	{
+		return size_t(base % 64);
+	}
+
+	void pop_slot()
+	{
+		slots.pop_front();
+		++base;
+		if (bit_offset() == 0 && !filled.empty())
+			filled.pop_front();
+	}
+
+	vector_queue<std::optional<T>, slot_allocator> slots;
+	vector_queue<uint64_t, bitmap_allocator> filled;
+	uint64_t base;
+	size_t window;
+};
@@ -0,0 +1,136 @@
+#pragma once
+/*
+Copyright (c) 2021 Christian Olsson
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <cstdint>
+#include "vector_queue.h"
+
+// A vector_queue that numbers its elements with a 64 bit sequence number that stays with the element
+// when elements are popped or pushed at the front. The front element has sequence number first_seq()
+// and the element at index i has first_seq() + i, so erase() and insert() renumber the elements after them.
+// Only the members of this class keep the numbering, don't pop through a reference to the base class.
+template <class T, class Alloc = std::allocator<T>>
+struct sequenced_vector_queue : vector_queue<T, Alloc>
+{
+	using base_type = vector_queue<T, Alloc>;
+	using typename base_type::iterator;
+	using typename base_type::const_iterator;
+
+	constexpr sequenced_vector_queue() = default;
+	constexpr explicit sequenced_vector_queue(uint64_t first_seq, const Alloc& alloc = Alloc()) : base_type(alloc), base_seq(first_seq)
+	{}
+
+	sequenced_vector_queue(sequenced_vector_queue&& other) noexcept : base_type(std::move(other)), base_seq(other.base_seq)
+	{}
+
+	sequenced_vector_queue(const sequenced_vector_queue& other) = default;
+
+	sequenced_vector_queue& operator=(sequenced_vector_queue&& other) noexcept
+	{
+		base_type::operator=(std::move(other));
+		base_seq = other.base_seq;
+		return *this;
+	}
+
+	sequenced_vector_queue& operator=(const sequenced_vector_queue& other) = default;
+
+	uint64_t first_seq() const
+	{
+		return base_seq;
+	}
+
+	// sequence number of the back element, first_seq() - 1 when empty
+	uint64_t last_seq() const
+	{
+		return base_seq + this->size() - 1;
+	}
+
+	// sequence number the next pushed back element gets
+	uint64_t end_seq() const
+	{
+		return base_seq + this->size();
+	}
+
+	bool contains_seq(uint64_t seq) const
+	{
+		return seq - base_seq < this->size();
+	}
+
+	T& at_seq(uint64_t seq)
+	{
+		return (*this)[size_t(seq - base_seq)];
+	}
+
+	const T& at_seq(uint64_t seq) const
+	{
+		return (*this)[size_t(seq - base_seq)];
+	}
+
+	uint64_t seq_of(const_iterator it) const
+	{
+		return base_seq + uint64_t(it - this->cbegin());
+	}
+
+	iterator find_seq(uint64_t seq)
+	{
+		return contains_seq(seq) ? this->begin() + ptrdiff_t(seq - base_seq) : this->end();
+	}
+
+	template <class... Args, class = std::enable_if_t<std::is_constructible_v<T, Args...>>>
+	void emplace_front(Args&&... args)
+	{
+		base_type::emplace_front(std::forward<Args>(args)...);
+		--base_seq;
+	}
+
+	void push_front(const T& value)
+	{
+		emplace_front(value);
+	}
+
+	void push_front(T&& value)
+	{
+		emplace_front(std::move(value));
+	}
+
+	void pop_front()
+	{
+		base_type::pop_front();
+		++base_seq;
+	}
+
+	// the numbering continues after the cleared elements
+	void clear()
+	{
+		base_seq += this->size();
+		base_type::clear();
+	}
+
+	void swap(sequenced_vector_queue& other) noexcept(noexcept(std::declval<base_type&>().swap(other)))
+	{
+		base_type::swap(other);
+		std::swap(base_seq, other.base_seq);
+	}
+
+private:
+	uint64_t base_seq = 0;
+};
@@ -0,0 +1,223 @@
+#pragma once
+/*
+Copyright (c) 2021 Christian Olsson
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdlib>
+#include <limits>
+#include <new>
+
+// counters of the calling thread's buffer cache
+struct size_class_stats
+{
+	size_t hits = 0; // allocations served from the cache
+	size_t misses = 0; // allocations that went to operator new
+	size_t recycled = 0; // deallocations kept in the cache
+	size_t released = 0; // deallocations that went to operator delete because the cache was full
+
+	double hit_rate() const
+	{
+		return hits + misses == 0 ? 0.0 : double(hits) / double(hits + misses);
+	}
+};
+
+namespace vq::detail
+{
+	// Free lists of buffers per power of two size in bytes up to MaxBytes, linked through the buffers
+	// themselves. There is one per thread for each MaxBytes and MaxCached, shared by the
+	// size_class_allocators with those parameters.
+	template <size_t MaxBytes, size_t MaxCached>
+	struct size_class_cache
+	{
+		static constexpr size_t min_bytes = sizeof(void*) * 2;
+		static constexpr int classes = std::countr_zero(MaxBytes) + 1;
+
+		void* lists[classes] = {};
+		size_t counts[classes] = {};
+		size_class_stats stats;
+
+		size_class_cache() = default;
+		size_class_cache(const size_class_cache&) = delete;
+		size_class_cache& operator=(const size_class_cache&) = delete;
+
+		~size_class_cache()
+		{
+			release();
+			current = nullptr;
+			destroyed = true;
+		}
+
+		// the calling thread's cache, or null once it's destroyed and buffers freed later by other
+		// thread_locals bypass it. The pointer is constant initialized so the usual path reads it
+		// without the guard of the thread_local cache itself.
+		static size_class_cache* get()
+		{
+			if (current) [[likely]]
+				return current;
+			return create();
+		}
+
+		void* pop(size_t bytes)
+		{
+			auto size_class = std::countr_zero(bytes);
+			void* buffer = lists[size_class];
+			if (!buffer)
+			{
+				++stats.misses;
+				return nullptr;
+			}
+			lists[size_class] = *static_cast<void**>(buffer);
+			--counts[size_class];
+			++stats.hits;
+			return buffer;
+		}
+
+		bool push(void* buffer, size_t bytes)
+		{
+			auto size_class = std::countr_zero(bytes);
+			if (counts[size_class] >= MaxCached)
+			{
+				++stats.released;
+				return false;
+			}
+			*static_cast<void**>(buffer) = lists[size_class];
+			lists[size_class] = buffer;
+			++counts[size_class];
+			++stats.recycled;
+			return true;
+		}
+
+		void release()
+		{
+			for (int size_class = 0; size_class < classes; ++size_class)
+			{
+				while (void* buffer = lists[size_class])
+				{
+					lists[size_class] = *static_cast<void**>(buffer);
+					::operator delete(buffer, size_t(1) << size_class);
+				}
+				counts[size_class] = 0;
+			}
+		}
+
+	private:
+		static size_class_cache* create()
+		{
+			if (destroyed)
+				return nullptr;
+			thread_local size_class_cache cache;
+			current = &cache;
+			return current;
+		}
+
+		static inline constinit thread_local size_class_cache* current = nullptr;
+		static inline constinit thread_local bool destroyed = false;
+	};
+}
+
+// An allocator that rounds every allocation up to a power of two number of bytes and keeps freed
+// buffers in per thread free lists per size, so queues that are created, grown and destroyed over
+// and over reuse the same buffers instead of going to malloc. Buffers up to MaxBytes are cached,
+// at most MaxCached of each size per thread. A buffer freed on another thread than the one that
+// allocated it goes to the cache of the freeing thread. Allocators with different MaxBytes or
+// MaxCached have separate caches.
+template <class T, size_t MaxBytes = size_t(1) << 20, size_t MaxCached = 32>
+struct size_class_allocator
+{
+	static_assert(alignof(T) <= __STDCPP_DEFAULT_NEW_ALIGNMENT__, "over-aligned types are not supported");
+	static_assert(std::has_single_bit(MaxBytes));
+
+	using cache_type = vq::detail::size_class_cache<MaxBytes, MaxCached>;
+
+	using value_type = T;
+	template <class U>
+	struct rebind
+	{
+		using other = size_class_allocator<U, MaxBytes, MaxCached>;
+	};
+
+	size_class_allocator() = default;
+	template <class U>
+	size_class_allocator(const size_class_allocator<U, MaxBytes, MaxCached>&) noexcept {}
+
+	T* allocate(size_t n)
+	{
+		if (n > std::numeric_limits<size_t>::max() / 2 / sizeof(T))
+		{
+#ifndef VECTOR_QUEUE_NO_EXCEPTIONS
+			throw std::bad_array_new_length();
+#else
+			std::abort();
+#endif
+		}
+		size_t bytes = class_bytes(n);
+		if (bytes <= MaxBytes)
+		{
+			if (auto cache = cache_type::get())
+			{
+				if (void* buffer = cache->pop(bytes))
+					return static_cast<T*>(buffer);
+			}
+		}
+		return static_cast<T*>(::operator new(bytes));
+	}
+
+	void deallocate(T* buffer, size_t n) noexcept
+	{
+		size_t bytes = class_bytes(n);
+		if (bytes <= MaxBytes)
+		{
+			auto cache = cache_type::get();
+			if (cache && cache->push(buffer, bytes))
+				return;
+		}
+		::operator delete(buffer, bytes);
+	}
+
+	// the counters of the calling thread, shared by the size_class_allocators with the same MaxBytes and MaxCached
+	static size_class_stats stats()
+	{
+		auto cache = cache_type::get();
+		return cache ? cache->stats : size_class_stats{};
+	}
+
+	// free the buffers cached by the calling thread
+	static void release_cached()
+	{
+		if (auto cache = cache_type::get())
+			cache->release();
+	}
+
+	friend bool operator==(const size_class_allocator&, const size_class_allocator&) noexcept
+	{
+		return true;
+	}
+
+private:
+	static size_t class_bytes(size_t n)
+	{
+		return std::bit_ceil(std::max(n * sizeof(T), cache_type::min_bytes));
+	}
+};
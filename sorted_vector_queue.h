@@ -0,0 +1,275 @@
+#pragma once
+/*
+Copyright (c) 2021 Christian Olsson
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#include <bit>
+#include <functional>
+#include <iterator>
+#include "vector_queue.h"
+
+// A vector_queue kept sorted by Compare, a cache friendly replacement for std::multiset when
+// inserts mostly land near either end. Inserts binary search for the position and shift the
+// elements towards the closer end, equal elements keep the order they were inserted in.
+// The smallest element is front() and is removed with pop_front().
+template <class T, class Compare = std::less<T>, class Alloc = std::allocator<T>>
+class sorted_vector_queue
+{
+public:
+	using queue_type = vector_queue<T, Alloc>;
+	using value_type = T;
+	using const_reference = const T&;
+	using const_iterator = typename queue_type::const_iterator;
+	using iterator = const_iterator; // elements can't be changed in place, that could break the order
+
+	sorted_vector_queue() = default;
+	explicit sorted_vector_queue(const Compare& comp, const Alloc& alloc = Alloc()) : queue(alloc), comp(comp)
+	{}
+
+	const_iterator begin() const { return queue.begin(); }
+	const_iterator end() const { return queue.end(); }
+	const_iterator cbegin() const { return queue.cbegin(); }
+	const_iterator cend() const { return queue.cend(); }
+
+	const T& operator[](size_t index) const
+	{
+		return queue[index];
+	}
+
+	const T& front() const
+	{
+		return queue.front();
+	}
+
+	const T& back() const
+	{
+		return queue.back();
+	}
+
+	size_t size() const
+	{
+		return queue.size();
+	}
+
+	bool empty() const
+	{
+		return queue.empty();
+	}
+
+	size_t capacity() const
+	{
+		return queue.capacity();
+	}
+
+	void reserve(size_t new_capacity)
+	{
+		queue.reserve(new_capacity);
+	}
+
+	void clear()
+	{
+		queue.clear();
+	}
+
+	const queue_type& get_queue() const
+	{
+		return queue;
+	}
+
+	// index of the first element not less than value
+	size_t lower_bound_index(const T& value) const
+	{
+		return bound([&](const T& element) { return comp(element, value); });
+	}
+
+	// index of the first element greater than value
+	size_t upper_bound_index(const T& value) const
+	{
+		return bound([&](const T& element) { return !comp(value, element); });
+	}
+
+	const_iterator lower_bound(const T& value) const
+	{
+		return begin() + lower_bound_index(value);
+	}
+
+	const_iterator upper_bound(const T& value) const
+	{
+		return begin() + upper_bound_index(value);
+	}
+
+	std::pair<const_iterator, const_iterator> equal_range(const T& value) const
+	{
+		return { lower_bound(value), upper_bound(value) };
+	}
+
+	const_iterator find(const T& value) const
+	{
+		auto it = lower_bound(value);
+		return it != end() && !comp(value, *it) ? it : end();
+	}
+
+	bool contains(const T& value) const
+	{
+		return find(value) != end();
+	}
+
+	size_t count(const T& value) const
+	{
+		return upper_bound_index(value) - lower_bound_index(value);
+	}
+
+	const_iterator insert(const T& value)
+	{
+		return emplace(value);
+	}
+
+	const_iterator insert(T&& value)
+	{
+		return emplace(std::move(value));
+	}
+
+	// inserted after the elements equal to it
+	template <class... Args>
+	const_iterator emplace(Args&&... args)
+	{
+		T value(std::forward<Args>(args)...);
+		if (empty() || !comp(value, back()))
+		{
+			queue.emplace_back(std::move(value));
+			return end() - 1;
+		}
+		if (comp(value, front()))
+		{
+			queue.emplace_front(std::move(value));
+			return begin();
+		}
+		size_t index = upper_bound_index(value);
+		queue.emplace(queue.begin() + index, std::move(value));
+		return begin() + index;
+	}
+
+	// Merge a range sorted by the same Compare. Small batches are inserted one by one,
+	// larger ones are merged with the whole queue in one linear pass. A single pass range
+	// is read into a temporary queue first.
+	template <class Iter>
+	void merge_sorted(Iter first, Iter last)
+	{
+		if constexpr (!std::forward_iterator<Iter>)
+		{
+			queue_type buffer(queue.get_allocator());
+			for (; first != last; ++first)
+				buffer.push_back(*first);
+			merge_sorted(buffer.begin(), buffer.end());
+		}
+		else
+		{
+			size_t n = std::distance(first, last);
+			if (n == 0)
+				return;
+			if (empty() || !comp(*first, back()))
+			{
+				queue.reserve(size() + n);
+				for (; first != last; ++first)
+					queue.push_back(*first);
+				return;
+			}
+			if (n * std::bit_width(size()) < size())
+			{
+				for (; first != last; ++first)
+					emplace(*first);
+				return;
+			}
+			queue_type merged(queue.get_allocator());
+			merged.reserve(size() + n);
+			auto it = queue.begin();
+			for (; first != last; ++first)
+			{
+				// equal elements already in the queue go first
+				while (it != queue.end() && !comp(*first, *it))
+					merged.push_back(std::move(*it++));
+				merged.push_back(*first);
+			}
+			for (; it != queue.end(); ++it)
+				merged.push_back(std::move(*it));
+			queue.swap(merged);
+		}
+	}
+
+	template <class Range>
+	void merge_sorted(const Range& range)
+	{
+		merge_sorted(std::begin(range), std::end(range));
+	}
+
+	void pop_front()
+	{
+		queue.pop_front();
+	}
+
+	void pop_back()
+	{
+		queue.pop_back();
+	}
+
+	void erase(const_iterator pos)
+	{
+		queue.erase(queue.begin() + (pos - begin()));
+	}
+
+	void erase(const_iterator first, const_iterator last)
+	{
+		queue.erase(queue.begin() + (first - begin()), queue.begin() + (last - begin()));
+	}
+
+	// erase the elements equal to value, returns how many there were
+	size_t erase(const T& value)
+	{
+		size_t first = lower_bound_index(value);
+		size_t last = upper_bound_index(value);
+		if (first != last)
+			queue.erase(queue.begin() + first, queue.begin() + last);
+		return last - first;
+	}
+
+private:
+	// the number of elements before the first one where before(element) is false, the search
+	// halves the range without branching on the comparison so the compiler can use cmov
+	template <class Pred>
+	size_t bound(Pred before) const
+	{
+		size_t n = size();
+		if (n == 0)
+			return 0;
+		size_t first = 0;
+		while (n > 1)
+		{
+			size_t half = n / 2;
+			first = before(queue[first + half - 1]) ? first + half : first;
+			n -= half;
+		}
+		return first + before(queue[first]);
+	}
+
+	queue_type queue;
+	[[no_unique_address]] Compare comp;
+};
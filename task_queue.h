@@ -0,0 +1,287 @@
+#pragma once
+/*
+Copyright (c) 2021 Christian Olsson
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include "vector_queue.h"
+
+struct task_queue_unit
+{
+	alignas(8) std::byte bytes[8];
+};
+
+// A queue of void() callables stored inline in a growable ring, without an allocation per task.
+// Every task is a one unit header holding a pointer to its vtable followed by the callable object.
+// Callables that are over aligned or may throw when moved are stored in a heap allocated box instead.
+// A task that would straddle the end of the ring is placed at the start of the ring and the skipped
+// units are covered by padding, whose header is the unit count shifted up with the lowest bit set.
+template <class Alloc = std::allocator<task_queue_unit>>
+class task_queue
+{
+public:
+	using unit = task_queue_unit;
+	using allocator_type = typename std::allocator_traits<Alloc>::template rebind_alloc<unit>;
+	using ring_type = vector_queue<unit, allocator_type>;
+
+	task_queue() = default;
+	explicit task_queue(const allocator_type& alloc) : ring(alloc), retired(alloc)
+	{}
+
+	task_queue(const task_queue&) = delete;
+	task_queue& operator=(const task_queue&) = delete;
+
+	~task_queue()
+	{
+		clear();
+	}
+
+	template <class F, class = std::enable_if_t<std::is_invocable_v<std::decay_t<F>&>>>
+	void emplace_back(F&& f)
+	{
+		using stored = std::decay_t<F>;
+		if constexpr (alignof(stored) > alignof(unit) || !std::is_nothrow_move_constructible_v<stored>)
+			emplace_task<task_box<stored>>(std::make_unique<stored>(std::forward<F>(f)));
+		else
+			emplace_task<stored>(std::forward<F>(f));
+	}
+
+	template <class F>
+	void push_back(F&& f)
+	{
+		emplace_back(std::forward<F>(f));
+	}
+
+	// invoke the front task and pop it, the task may push new tasks while it runs
+	void invoke_front()
+	{
+		auto vt = front_vtable();
+		void* object = ring.array + ring.start() + 1;
+		struct pop_guard
+		{
+			task_queue& q;
+			~pop_guard()
+			{
+				q.invoking = false;
+				if (q.detached)
+				{
+					q.front_vtable(q.retired)->destroy(q.retired.array + q.retired.start() + 1);
+					q.retired = ring_type{ q.retired.alloc };
+					q.detached = false;
+				}
+				else
+				{
+					q.pop_front();
+				}
+			}
+		} guard{ *this };
+		invoking = true;
+		vt->invoke(object);
+	}
+
+	// pop the front task without invoking it
+	void pop_front()
+	{
+		front_vtable()->destroy(ring.array + ring.start() + 1);
+		drop_front();
+		--count;
+		while (!ring.empty() && is_padding(read_header(ring.start())))
+			drop_front();
+	}
+
+	void clear()
+	{
+		while (!empty())
+			pop_front();
+		ring.clear();
+	}
+
+	size_t size() const
+	{
+		return count;
+	}
+
+	bool empty() const
+	{
+		return count == 0;
+	}
+
+	size_t capacity_bytes() const
+	{
+		return ring.capacity() * sizeof(unit);
+	}
+
+private:
+	struct vtable
+	{
+		void (*invoke)(void*);
+		void (*relocate)(void* to, void* from) noexcept;
+		void (*destroy)(void*) noexcept;
+		size_t units;
+	};
+
+	static constexpr size_t units_for(size_t size)
+	{
+		return 1 + (size + sizeof(unit) - 1) / sizeof(unit);
+	}
+
+	template <class F>
+	struct task_box
+	{
+		std::unique_ptr<F> f;
+		void operator()()
+		{
+			std::invoke(*f);
+		}
+	};
+
+	template <class F>
+	static constexpr vtable vtable_for = {
+		[](void* p) { std::invoke(*static_cast<F*>(p)); },
+		[](void* to, void* from) noexcept
+		{
+			std::construct_at(static_cast<F*>(to), std::move(*static_cast<F*>(from)));
+			std::destroy_at(static_cast<F*>(from));
+		},
+		[](void* p) noexcept { std::destroy_at(static_cast<F*>(p)); },
+		units_for(sizeof(F))
+	};
+
+	static constexpr bool is_padding(uintptr_t header)
+	{
+		return header & 1;
+	}
+
+	static size_t header_units(uintptr_t header)
+	{
+		if (is_padding(header))
+			return header >> 1;
+		return reinterpret_cast<const vtable*>(header)->units;
+	}
+
+	static void write_header(ring_type& r, size_t index, uintptr_t header)
+	{
+		std::memcpy(r.array[index].bytes, &header, sizeof(header));
+	}
+
+	static uintptr_t read_header(const ring_type& r, size_t index)
+	{
+		uintptr_t header;
+		std::memcpy(&header, r.array[index].bytes, sizeof(header));
+		return header;
+	}
+
+	uintptr_t read_header(size_t index) const
+	{
+		return read_header(ring, index);
+	}
+
+	static const vtable* front_vtable(const ring_type& r)
+	{
+		return reinterpret_cast<const vtable*>(read_header(r, r.start()));
+	}
+
+	const vtable* front_vtable() const
+	{
+		return front_vtable(ring);
+	}
+
+	template <class F, class Arg>
+	void emplace_task(Arg&& arg)
+	{
+		constexpr size_t units = units_for(sizeof(F));
+		if (ring.empty())
+			ring.set_start(0);
+		size_t back = ring.wrap_up(ring.size());
+		bool wrap = false;
+		if (ring.size() == ring.capacity() || (back >= ring.start() && units > ring.capacity() - back && units > ring.start())
+			|| (back < ring.start() && units > ring.start() - back))
+		{
+			grow(units);
+			back = ring.size();
+		}
+		else if (back >= ring.start() && units > ring.capacity() - back)
+		{
+			// does not fit before the end of the ring, skip to the beginning
+			wrap = true;
+		}
+		size_t at = wrap ? 0 : back;
+		std::construct_at(reinterpret_cast<F*>(ring.array + at + 1), std::forward<Arg>(arg));
+		if (wrap)
+		{
+			write_header(ring, back, ((ring.capacity() - back) << 1) | 1);
+			ring._size += ring.capacity() - back;
+		}
+		write_header(ring, at, reinterpret_cast<uintptr_t>(&vtable_for<F>));
+		ring._size += units;
+		++count;
+	}
+
+	// move the tasks to a bigger ring, the task being invoked stays where it is until it returns
+	void grow(size_t units)
+	{
+		ring_type next{ ring.alloc };
+		next.reserve(std::max(ring.size() + units, ring.next_capacity()));
+		bool detach = invoking && !detached;
+		size_t index = ring.start();
+		size_t remaining = ring.size();
+		while (remaining > 0)
+		{
+			auto header = read_header(index);
+			auto n = header_units(header);
+			if (detach && index == ring.start())
+			{
+				--count;
+			}
+			else if (!is_padding(header))
+			{
+				write_header(next, next._size, header);
+				reinterpret_cast<const vtable*>(header)->relocate(next.array + next._size + 1, ring.array + index + 1);
+				next._size += n;
+			}
+			index = (index + n) & (ring.capacity() - 1);
+			remaining -= n;
+		}
+		ring._size = 0;
+		if (detach)
+		{
+			retired.swap(ring);
+			detached = true;
+		}
+		ring.swap(next);
+	}
+
+	void drop_front()
+	{
+		auto units = header_units(read_header(ring.start()));
+		ring.set_start(ring.wrap_up(units));
+		ring._size -= units;
+	}
+
+	ring_type ring;
+	ring_type retired;
+	size_t count = 0;
+	bool invoking = false;
+	bool detached = false;
+};
@@ -1,268 +1,1650 @@
-#define CATCH_CONFIG_MAIN
-//#define VECTOR_QUEUE_HAS_SSE
-#include <catch.hpp>
-#include <vector_queue.h>
-
-template <class T>
-bool equals(const vector_queue<T>& q, std::initializer_list<T> l)
-{
-	return std::equal(q.begin(), q.end(), l.begin(), l.end());
-}
-
-TEST_CASE("push_pop")
-{
-	vector_queue<int> q{1,2,3,4};
-	REQUIRE(equals(q, { 1,2,3,4 }));
-	//REQUIRE(q == {1, 2, 3, 4});
-	q.emplace_back(5);
-	q.pop_front();
-
-	q.emplace_back(5);
-	q.pop_front();
-
-	q.emplace_back(5);
-	q.pop_front();
-	REQUIRE(equals(q, { 4, 5, 5, 5 }));
-	q.erase(std::find(q.begin(), q.end(), 4));
-	REQUIRE(equals(q, { 5, 5, 5 }));
-	q.emplace_front(4);
-	q.emplace_back(6);
-	REQUIRE(equals(q, { 4, 5, 5, 5, 6}));
-	q.erase(std::find(q.begin(), q.end(), 6));
-	REQUIRE(equals(q, { 4, 5, 5, 5 }));
-	q.pop_back();
-	REQUIRE(equals(q, { 4, 5, 5 }));
-
-}
-
-
-TEST_CASE("push_pop_complex")
-{
-	using namespace  std::string_literals;
-	vector_queue<std::string> q;
-	q.emplace_back("test");
-	q.emplace_back("hello world!");
-	q.pop_front();
-	q.emplace_front("test\n");
-	q.emplace_front("test2\n");
-	q.emplace_front("at capacity!\n");
-	REQUIRE(equals(q, { "at capacity!\n"s , "test2\n"s, "test\n"s,  "hello world!"s }));
-	q.emplace_front("realloc!\n");
-	REQUIRE(equals(q, { "realloc!\n"s, "at capacity!\n"s , "test2\n"s, "test\n"s,  "hello world!"s }));
-	q.erase(std::find(q.begin(), q.end(), "hello world!"));
-	REQUIRE(equals(q, { "realloc!\n"s, "at capacity!\n"s , "test2\n"s, "test\n"s}));
-}
-
-TEST_CASE("erase test")
-{
-	auto init = { 1,2,3,4 };
-	vector_queue<int> q(init);
-	q.erase(q.begin(), q.end());
-	REQUIRE(equals(q, {}));
-	q = init;
-	REQUIRE(equals(q, init));
-	q.erase(++q.begin(), --q.end());
-	REQUIRE(equals(q, { 1,4 }));
-	q.erase(q.begin());
-	REQUIRE(equals(q, { 4 }));
-	
-}
-
-
-TEST_CASE("insert test")
-{
-	auto init = { 1,2,3,4 };
-	vector_queue<int> q(init);
-	q.insert(q.begin() + 1, init.begin(), init.end());
-	REQUIRE(equals(q, { 1,1,2,3,4,2,3,4 }));
-	q = init;
-	q.insert(q.end(), init.begin(), init.end());
-	REQUIRE(equals(q, { 1,2,3,4,1,2,3,4 }));
-	q = init;
-	q.insert(q.begin(), init.begin(), init.end());
-	REQUIRE(equals(q, { 1,2,3,4,1,2,3,4 }));
-
-	vector_queue<int>::iterator it = q.begin();
-	*it = 5;
-	q.clear();
-
-	q.insert(q.end(), init.begin(), init.end());
-	REQUIRE(equals(q, init));
-	q.clear();
-
-	q.insert(q.begin(), init.begin(), init.end());
-	REQUIRE(equals(q, init));
-	REQUIRE(q.capacity() >= 8);
-	q.insert(q.begin(), init.begin(), init.end());
-	REQUIRE(equals(q, { 1,2,3,4,1,2,3,4 }));
-	q.clear();
-	q.insert(q.begin(), init.begin(), init.end());
-	REQUIRE(equals(q, init));
-	q.insert(q.begin() + 1, init.begin(), init.end());
-	REQUIRE(equals(q, { 1,1,2,3,4,2,3,4 }));
-	q.erase(q.begin() + 1, q.begin() + 5);
-	q.insert(q.end(), init.begin(), init.end());
-	REQUIRE(equals(q, { 1,2,3,4,1,2,3,4 }));
-
-	q.erase(q.begin(), q.begin() + 4);
-	q.insert(q.end()-1, init.begin(), init.end());
-	REQUIRE(equals(q, { 1,2,3,1,2,3,4,4 }));
-}
-
-TEST_CASE("pop/insert test")
-{
-	auto init = { 1,2,3,4 };
-	vector_queue<int> q(init);
-	q.insert(++q.begin(), 5);
-	q.pop_front();
-	REQUIRE(equals(q, { 5,2,3,4 }));
-	for(int i = 0; i < 4; ++i)
-	{
-		q.insert(q.begin() + i, i + 6);
-	}
-	REQUIRE(equals(q, { 6,7,8,9,5,2,3,4 }));
-
-	for (int i = 0; i < 4; ++i)
-		q.pop_front();
-
-	for (int i = 0; i < 4; ++i)
-	{
-		q.insert(q.end() - i, i + 6);
-	}
-	REQUIRE(equals(q, { 5,2,3,4,9,8,7,6 }));
-
-}
-
-TEST_CASE("emplace test")
-{
-	auto init = { 1,2,3,4 };
-	vector_queue<int> q(init);
-	q.erase(q.end() - 2);
-	REQUIRE(equals(q, { 1,2,4 }));
-
-	q.emplace(q.end()-1, 3);
-	REQUIRE(equals(q, { 1,2,3,4 }));
-	q.erase(q.begin()+1);
-	q.emplace(q.begin() + 1, 2);
-	REQUIRE(equals(q, { 1,2,3,4 }));
-	q.emplace(q.end() - 1, 3);
-	REQUIRE(equals(q, { 1,2,3,3,4 }));
-	q = {};
-	q.emplace(q.end(), 1);
-	REQUIRE(equals(q, { 1 }));
-}
-
-TEST_CASE("rounding")
-{
-	vector_queue<uint64_t> q;
-	q.reserve(2);
-	REQUIRE(q.capacity() == 2);
-	q.reserve(3);
-	REQUIRE(q.capacity() == 4);
-	q.reserve(8);
-	REQUIRE(q.capacity() == 8);
-	q.reserve(9);
-	REQUIRE(q.capacity() == 16);
-
-}
-
-TEST_CASE("find small queue")
-{
-	auto init = std::initializer_list<uint8_t>{ 1,2,3,4,1,2,3,4,1,2,3,4,1,2,3,4 };
-	vector_queue<uint8_t> q{init};
-	q.pop_front();
-	q.emplace_back(5);
-	REQUIRE(q.capacity() == q.size());
-	auto it = q.find(5);
-	REQUIRE(it != q.end());
-	REQUIRE(*it == 5);
-	q.erase(q.begin(), q.begin() + 8);
-	it = q.find(5);
-	REQUIRE(it != q.end());
-	REQUIRE(*it == 5);
-	
-}
-
-TEST_CASE("find big queue")
-{
-	auto init = std::initializer_list<uint8_t>{ 1,2,3,4,1,2,3,4,1,2,3,4,1,2,3,4,1,2,3,4,1,2,3,4,1,2,3,4,1,2,3,4 };
-	vector_queue<uint8_t> q{ init };
-	q.pop_front();
-	q.emplace_back(5);
-	REQUIRE(q.capacity() == q.size());
-	auto it = q.find(5);
-	REQUIRE(it != q.end());
-	REQUIRE(*it == 5);
-	q[18] = 8;
-	it = q.find(8);
-	REQUIRE(it != q.end());
-	REQUIRE(*it == 8);
-	REQUIRE(it - q.begin() == 18);
-	*it = 0;
-	q.erase(q.begin(), q.begin() + 8);
-	it = q.find(5);
-	REQUIRE(it != q.end());
-	REQUIRE(*it == 5);
-	q[18] = 8;
-	it = q.find(8);
-	REQUIRE(it != q.end());
-	REQUIRE(*it == 8);
-	REQUIRE(it - q.begin() == 18);
-}
-
-
-TEST_CASE("find big element SSE")
-{
-	auto init = std::initializer_list<uint16_t>{ 1,2,3,4,1,2,3,4,1,2,3,4,1,2,3,4 };
-	vector_queue<uint16_t> q{ init };
-	q.pop_front();
-	q.emplace_back(5);
-	REQUIRE(q.capacity() == q.size());
-	auto it = q.find(5);
-	REQUIRE(it != q.end());
-	REQUIRE(*it == 5);
-	it = q.find(5);
-	REQUIRE(it != q.end());
-	REQUIRE(*it == 5);
-	q[10] = 8;
-	it = q.find(8);
-	REQUIRE(it != q.end());
-	REQUIRE(*it == 8);
-	REQUIRE(it - q.begin() == 10);
-}
-
-TEST_CASE("find bigger element SSE")
-{
-	auto init = std::initializer_list<uint32_t>{ 1,2,3,4,1,2,3,4,1,2,3,4,1,2,3,4 };
-	vector_queue<uint32_t> q{ init };
-	q.pop_front();
-	q.emplace_back(5);
-	REQUIRE(q.capacity() == q.size());
-	auto it = q.find(5);
-	REQUIRE(it != q.end());
-	REQUIRE(*it == 5);
-	it = q.find(5);
-	REQUIRE(it != q.end());
-	REQUIRE(*it == 5);
-	q[10] = 8;
-	it = q.find(8);
-	REQUIRE(it != q.end());
-	REQUIRE(*it == 8);
-	REQUIRE(it - q.begin() == 10);
-}
-
-
-TEST_CASE("insert front/back")
-{
-	vector_queue<int> q;
-	q.push_front(1);
-	q.push_back(4);
-	q.insert(q.begin() + 1, 2);
-	q.insert(q.begin() + 2, 3);
-	REQUIRE(equals(q, { 1,2,3,4 }));
-	q.push_back(8);
-	q.insert(q.end() - 1, 7);
-	q.insert(q.end() - 2, 6);
-	q.insert(q.end() - 3, 5);
-	REQUIRE(equals(q, { 1,2,3,4,5,6,7,8 }));
-}
\ No newline at end of file
+#define CATCH_CONFIG_MAIN
+//#define VECTOR_QUEUE_HAS_SSE
+#include <catch.hpp>
+#include <vector_queue.h>
+#include <vector_queue_streambuf.h>
+#include <record_queue.h>
+#include <task_queue.h>
+#include <reorder_buffer.h>
+#include <sequenced_vector_queue.h>
+#include <vector_queue_algorithm.h>
+#include <sorted_vector_queue.h>
+#include <incremental_vector_queue.h>
+#include <block_vector_queue.h>
+#include <size_class_allocator.h>
+#include <vector_queue_pool.h>
+#include <huge_page_allocator.h>
+#include <cmath>
+#include <deque>
+#include <memory_resource>
+#include <set>
+#include <limits>
+#include <numeric>
+#include <thread>
+#include <vector>
+#include <istream>
+#include <ostream>
+#include <sstream>
+
+template <class T, class... Params>
+bool equals(const vector_queue<T, Params...>& q, std::initializer_list<std::type_identity_t<T>> l)
+{
+	return std::equal(q.begin(), q.end(), l.begin(), l.end());
+}
+
+TEST_CASE("push_pop")
+{
+	vector_queue<int> q{1,2,3,4};
+	REQUIRE(equals(q, { 1,2,3,4 }));
+	//REQUIRE(q == {1, 2, 3, 4});
+	q.emplace_back(5);
+	q.pop_front();
+
+	q.emplace_back(5);
+	q.pop_front();
+
+	q.emplace_back(5);
+	q.pop_front();
+	REQUIRE(equals(q, { 4, 5, 5, 5 }));
+	q.erase(std::find(q.begin(), q.end(), 4));
+	REQUIRE(equals(q, { 5, 5, 5 }));
+	q.emplace_front(4);
+	q.emplace_back(6);
+	REQUIRE(equals(q, { 4, 5, 5, 5, 6}));
+	q.erase(std::find(q.begin(), q.end(), 6));
+	REQUIRE(equals(q, { 4, 5, 5, 5 }));
+	q.pop_back();
+	REQUIRE(equals(q, { 4, 5, 5 }));
+
+}
+
+
+TEST_CASE("push_pop_complex")
+{
+	using namespace  std::string_literals;
+	vector_queue<std::string> q;
+	q.emplace_back("test");
+	q.emplace_back("hello world!");
+	q.pop_front();
+	q.emplace_front("test\n");
+	q.emplace_front("test2\n");
+	q.emplace_front("at capacity!\n");
+	REQUIRE(equals(q, { "at capacity!\n"s , "test2\n"s, "test\n"s,  "hello world!"s }));
+	q.emplace_front("realloc!\n");
+	REQUIRE(equals(q, { "realloc!\n"s, "at capacity!\n"s , "test2\n"s, "test\n"s,  "hello world!"s }));
+	q.erase(std::find(q.begin(), q.end(), "hello world!"));
+	REQUIRE(equals(q, { "realloc!\n"s, "at capacity!\n"s , "test2\n"s, "test\n"s}));
+}
+
+TEST_CASE("erase test")
+{
+	auto init = { 1,2,3,4 };
+	vector_queue<int> q(init);
+	q.erase(q.begin(), q.end());
+	REQUIRE(equals(q, {}));
+	q = init;
+	REQUIRE(equals(q, init));
+	q.erase(++q.begin(), --q.end());
+	REQUIRE(equals(q, { 1,4 }));
+	q.erase(q.begin());
+	REQUIRE(equals(q, { 4 }));
+	
+}
+
+
+TEST_CASE("insert test")
+{
+	auto init = { 1,2,3,4 };
+	vector_queue<int> q(init);
+	q.insert(q.begin() + 1, init.begin(), init.end());
+	REQUIRE(equals(q, { 1,1,2,3,4,2,3,4 }));
+	q = init;
+	q.insert(q.end(), init.begin(), init.end());
+	REQUIRE(equals(q, { 1,2,3,4,1,2,3,4 }));
+	q = init;
+	q.insert(q.begin(), init.begin(), init.end());
+	REQUIRE(equals(q, { 1,2,3,4,1,2,3,4 }));
+
+	vector_queue<int>::iterator it = q.begin();
+	*it = 5;
+	q.clear();
+
+	q.insert(q.end(), init.begin(), init.end());
+	REQUIRE(equals(q, init));
+	q.clear();
+
+	q.insert(q.begin(), init.begin(), init.end());
+	REQUIRE(equals(q, init));
+	REQUIRE(q.capacity() >= 8);
+	q.insert(q.begin(), init.begin(), init.end());
+	REQUIRE(equals(q, { 1,2,3,4,1,2,3,4 }));
+	q.clear();
+	q.insert(q.begin(), init.begin(), init.end());
+	REQUIRE(equals(q, init));
+	q.insert(q.begin() + 1, init.begin(), init.end());
+	REQUIRE(equals(q, { 1,1,2,3,4,2,3,4 }));
+	q.erase(q.begin() + 1, q.begin() + 5);
+	q.insert(q.end(), init.begin(), init.end());
+	REQUIRE(equals(q, { 1,2,3,4,1,2,3,4 }));
+
+	q.erase(q.begin(), q.begin() + 4);
+	q.insert(q.end()-1, init.begin(), init.end());
+	REQUIRE(equals(q, { 1,2,3,1,2,3,4,4 }));
+}
+
+TEST_CASE("pop/insert test")
+{
+	auto init = { 1,2,3,4 };
+	vector_queue<int> q(init);
+	q.insert(++q.begin(), 5);
+	q.pop_front();
+	REQUIRE(equals(q, { 5,2,3,4 }));
+	for(int i = 0; i < 4; ++i)
+	{
+		q.insert(q.begin() + i, i + 6);
+	}
+	REQUIRE(equals(q, { 6,7,8,9,5,2,3,4 }));
+
+	for (int i = 0; i < 4; ++i)
+		q.pop_front();
+
+	for (int i = 0; i < 4; ++i)
+	{
+		q.insert(q.end() - i, i + 6);
+	}
+	REQUIRE(equals(q, { 5,2,3,4,9,8,7,6 }));
+
+}
+
+TEST_CASE("emplace test")
+{
+	auto init = { 1,2,3,4 };
+	vector_queue<int> q(init);
+	q.erase(q.end() - 2);
+	REQUIRE(equals(q, { 1,2,4 }));
+
+	q.emplace(q.end()-1, 3);
+	REQUIRE(equals(q, { 1,2,3,4 }));
+	q.erase(q.begin()+1);
+	q.emplace(q.begin() + 1, 2);
+	REQUIRE(equals(q, { 1,2,3,4 }));
+	q.emplace(q.end() - 1, 3);
+	REQUIRE(equals(q, { 1,2,3,3,4 }));
+	q = {};
+	q.emplace(q.end(), 1);
+	REQUIRE(equals(q, { 1 }));
+}
+
+TEST_CASE("rounding")
+{
+	vector_queue<uint64_t> q;
+	q.reserve(2);
+	REQUIRE(q.capacity() == 2);
+	q.reserve(3);
+	REQUIRE(q.capacity() == 4);
+	q.reserve(8);
+	REQUIRE(q.capacity() == 8);
+	q.reserve(9);
+	REQUIRE(q.capacity() == 16);
+
+}
+
+TEST_CASE("find small queue")
+{
+	auto init = std::initializer_list<uint8_t>{ 1,2,3,4,1,2,3,4,1,2,3,4,1,2,3,4 };
+	vector_queue<uint8_t> q{init};
+	q.pop_front();
+	q.emplace_back(5);
+	REQUIRE(q.capacity() == q.size());
+	auto it = q.find(5);
+	REQUIRE(it != q.end());
+	REQUIRE(*it == 5);
+	q.erase(q.begin(), q.begin() + 8);
+	it = q.find(5);
+	REQUIRE(it != q.end());
+	REQUIRE(*it == 5);
+	
+}
+
+TEST_CASE("find big queue")
+{
+	auto init = std::initializer_list<uint8_t>{ 1,2,3,4,1,2,3,4,1,2,3,4,1,2,3,4,1,2,3,4,1,2,3,4,1,2,3,4,1,2,3,4 };
+	vector_queue<uint8_t> q{ init };
+	q.pop_front();
+	q.emplace_back(5);
+	REQUIRE(q.capacity() == q.size());
+	auto it = q.find(5);
+	REQUIRE(it != q.end());
+	REQUIRE(*it == 5);
+	q[18] = 8;
+	it = q.find(8);
+	REQUIRE(it != q.end());
+	REQUIRE(*it == 8);
+	REQUIRE(it - q.begin() == 18);
+	*it = 0;
+	q.erase(q.begin(), q.begin() + 8);
+	it = q.find(5);
+	REQUIRE(it != q.end());
+	REQUIRE(*it == 5);
+	q[18] = 8;
+	it = q.find(8);
+	REQUIRE(it != q.end());
+	REQUIRE(*it == 8);
+	REQUIRE(it - q.begin() == 18);
+}
+
+
+TEST_CASE("find big element SSE")
+{
+	auto init = std::initializer_list<uint16_t>{ 1,2,3,4,1,2,3,4,1,2,3,4,1,2,3,4 };
+	vector_queue<uint16_t> q{ init };
+	q.pop_front();
+	q.emplace_back(5);
+	REQUIRE(q.capacity() == q.size());
+	auto it = q.find(5);
+	REQUIRE(it != q.end());
+	REQUIRE(*it == 5);
+	it = q.find(5);
+	REQUIRE(it != q.end());
+	REQUIRE(*it == 5);
+	q[10] = 8;
+	it = q.find(8);
+	REQUIRE(it != q.end());
+	REQUIRE(*it == 8);
+	REQUIRE(it - q.begin() == 10);
+}
+
+TEST_CASE("find bigger element SSE")
+{
+	auto init = std::initializer_list<uint32_t>{ 1,2,3,4,1,2,3,4,1,2,3,4,1,2,3,4 };
+	vector_queue<uint32_t> q{ init };
+	q.pop_front();
+	q.emplace_back(5);
+	REQUIRE(q.capacity() == q.size());
+	auto it = q.find(5);
+	REQUIRE(it != q.end());
+	REQUIRE(*it == 5);
+	it = q.find(5);
+	REQUIRE(it != q.end());
+	REQUIRE(*it == 5);
+	q[10] = 8;
+	it = q.find(8);
+	REQUIRE(it != q.end());
+	REQUIRE(*it == 8);
+	REQUIRE(it - q.begin() == 10);
+}
+
+
+enum class find_state : uint64_t { idle, one, two };
+
+template <class T>
+T find_value(int value)
+{
+	if constexpr (std::is_pointer_v<T>)
+		return reinterpret_cast<T>(uintptr_t(value) * 16);
+	else
+		return T(value);
+}
+
+template <class T>
+void check_find_every_position()
+{
+	for (size_t size : { 7, 40, 200, 1000 })
+	{
+		vector_queue<T> q;
+		for (size_t i = 0; i < size / 2; ++i)
+			q.push_back(find_value<T>(1));
+		for (size_t i = 0; i < size / 2; ++i)
+		{
+			q.pop_front();
+			q.push_back(find_value<T>(1));
+		}
+		for (size_t i = q.size(); i < size; ++i)
+			q.push_back(find_value<T>(1));
+		REQUIRE(q.find(find_value<T>(2)) == q.end());
+		REQUIRE(q.rfind(find_value<T>(2)) == q.end());
+		REQUIRE_FALSE(q.contains(find_value<T>(2)));
+		REQUIRE(q.contains(find_value<T>(1)));
+		for (size_t i = 0; i < size; ++i)
+		{
+			q[i] = find_value<T>(2);
+			REQUIRE(q.find(find_value<T>(2)) - q.begin() == ptrdiff_t(i));
+			REQUIRE(q.rfind(find_value<T>(2)) - q.begin() == ptrdiff_t(i));
+			q[i / 2] = find_value<T>(2);
+			REQUIRE(q.find(find_value<T>(2)) - q.begin() == ptrdiff_t(i / 2));
+			REQUIRE(q.rfind(find_value<T>(2)) - q.begin() == ptrdiff_t(i));
+			REQUIRE(q.count(find_value<T>(2)) == (i == 0 ? 1 : 2));
+			REQUIRE(q.count(find_value<T>(1)) == size - (i == 0 ? 1 : 2));
+			REQUIRE(q.find_any_of({ find_value<T>(3), find_value<T>(2) }) - q.begin() == ptrdiff_t(i / 2));
+			q[i / 2] = find_value<T>(1);
+			q[i] = find_value<T>(1);
+		}
+	}
+}
+
+TEST_CASE("find every position")
+{
+#ifdef VECTOR_QUEUE_SIMD
+	using vq::simd::level;
+	for (auto l : { level::sse2, level::avx2, level::avx512 })
+	{
+		vq::simd::limit_level(l);
+#endif
+		check_find_every_position<uint8_t>();
+		check_find_every_position<int16_t>();
+		check_find_every_position<int32_t>();
+		check_find_every_position<char>();
+		check_find_every_position<uint64_t>();
+		check_find_every_position<float>();
+		check_find_every_position<double>();
+		check_find_every_position<find_state>();
+		check_find_every_position<int*>();
+#ifdef VECTOR_QUEUE_SIMD
+	}
+	vq::simd::limit_level(level::avx512);
+#endif
+}
+
+TEST_CASE("find_if/find_last_if")
+{
+	vector_queue<std::string> q{ "a", "bb", "ccc", "dd", "e" };
+	q.pop_front();
+	q.push_back("ff");
+	REQUIRE(q.find_if([](auto& s) { return s.size() == 2; }) - q.begin() == 0);
+	REQUIRE(q.find_last_if([](auto& s) { return s.size() == 2; }) - q.begin() == 4);
+	REQUIRE(q.find_last_if([](auto& s) { return s.size() == 3; }) - q.begin() == 1);
+	REQUIRE(q.find_last_if([](auto& s) { return s.empty(); }) == q.end());
+}
+
+TEST_CASE("find_any_of many values")
+{
+	vector_queue<int> q;
+	for (int i = 0; i < 100; ++i)
+		q.push_back(i);
+	REQUIRE(q.find_any_of({ 200, 300, 99, 50, 400 }) - q.begin() == 50);
+	REQUIRE(q.find_any_of({ 101, 102, 103, 104, 105, 106, 107, 108, 109, 77, 88 }) - q.begin() == 77);
+	REQUIRE(q.find_any_of({ 101, 102 }) == q.end());
+	const auto& c = q;
+	REQUIRE(c.find_any_of({ 5 }) == c.cbegin() + 5);
+}
+
+template <class T>
+void check_reductions()
+{
+	for (size_t size : { 1, 9, 40, 333, 1000 })
+	{
+		vector_queue<T> q;
+		for (size_t i = 0; i < size; ++i)
+			q.push_back(T((i * 7919) % 1000) - T(300));
+		for (size_t i = 0; i < size / 3; ++i)
+		{
+			q.push_back(q.front());
+			q.pop_front();
+		}
+		REQUIRE(q.sum() == std::accumulate(q.begin(), q.end(), T{}));
+		auto lo = *std::min_element(q.begin(), q.end());
+		auto hi = *std::max_element(q.begin(), q.end());
+		REQUIRE(q.min() == lo);
+		REQUIRE(q.max() == hi);
+		REQUIRE(q.minmax() == std::pair{ lo, hi });
+	}
+}
+
+TEST_CASE("reductions")
+{
+#ifdef VECTOR_QUEUE_SIMD
+	using vq::simd::level;
+	for (auto l : { level::sse2, level::avx2, level::avx512 })
+	{
+		vq::simd::limit_level(l);
+#endif
+		check_reductions<int32_t>();
+		check_reductions<uint32_t>();
+		check_reductions<int64_t>();
+		check_reductions<uint64_t>();
+		check_reductions<float>();
+		check_reductions<double>();
+		check_reductions<int16_t>();
+#ifdef VECTOR_QUEUE_SIMD
+	}
+	vq::simd::limit_level(level::avx512);
+#endif
+	vector_queue<int32_t> q;
+	for (int i = 0; i < 100; ++i)
+		q.push_back(std::numeric_limits<int32_t>::max());
+	REQUIRE(q.sum() == int32_t(uint32_t(std::numeric_limits<int32_t>::max()) * 100));
+	vector_queue<std::string> strings{ "b", "c", "a" };
+	REQUIRE(strings.sum() == "bca");
+	REQUIRE(strings.minmax() == std::pair<std::string, std::string>{ "a", "c" });
+}
+
+TEST_CASE("find floating point")
+{
+	vector_queue<double> q;
+	for (int i = 0; i < 100; ++i)
+		q.push_back(std::nan(""));
+	q[50] = -0.0;
+	REQUIRE(q.find(std::nan("")) == q.end());
+	REQUIRE(q.find(0.0) - q.begin() == 50);
+	vector_queue<float> f;
+	for (int i = 0; i < 100; ++i)
+		f.push_back(float(i));
+	f[70] = std::numeric_limits<float>::infinity();
+	REQUIRE(f.find(std::numeric_limits<float>::infinity()) - f.begin() == 70);
+}
+
+TEST_CASE("segment algorithms")
+{
+	vector_queue<int> q;
+	q.reserve(20);
+	for (int i = 0; size_t(i) < q.capacity(); ++i)
+		q.push_back(i);
+	for (int i = 0; i < 5; ++i)
+	{
+		q.pop_front();
+		q.push_back(int(q.capacity()) + i);
+	}
+	size_t segments = 0, total = 0;
+	q.for_each_segment([&](std::span<int> s)
+		{
+			++segments;
+			total += s.size();
+		});
+	REQUIRE(segments == 2);
+	REQUIRE(total == q.size());
+
+	std::vector<int> out(q.size());
+	REQUIRE(vq::copy(q, out.data()) == out.data() + out.size());
+	REQUIRE(std::equal(out.begin(), out.end(), q.begin()));
+	std::vector<int> back;
+	vq::copy(q, std::back_inserter(back));
+	REQUIRE(back == out);
+
+	int sum = 0;
+	vq::for_each(std::as_const(q), [&](int v) { sum += v; });
+	REQUIRE(sum == std::accumulate(q.begin(), q.end(), 0));
+
+	std::vector<long long> squares;
+	vq::transform(q, std::back_inserter(squares), [](int v) { return (long long)v * v; });
+	REQUIRE(squares[3] == 64);
+	vq::transform(q, [](int v) { return v + 1; });
+	REQUIRE(q.front() == 6);
+	REQUIRE(q.back() == int(q.capacity()) + 5);
+
+	// b is linear while q wraps, so the segments split at different places
+	vector_queue<int> b;
+	for (int v : q)
+		b.push_back(v);
+	REQUIRE(vq::equal(q, b));
+	b[17] = -1;
+	REQUIRE(!vq::equal(q, b));
+	b.pop_back();
+	REQUIRE(!vq::equal(q, b));
+
+	vq::fill(q, 0);
+	REQUIRE(q.count(0) == q.size());
+	vq::fill(q, 0x01020304);
+	REQUIRE(q.count(0x01020304) == q.size());
+	vector_queue<std::string> strings{ "a", "b", "c" };
+	vq::fill(strings, std::string("x"));
+	REQUIRE(strings.count("x") == 3);
+
+	vector_queue<int> empty;
+	REQUIRE(vq::copy(empty, out.data()) == out.data());
+	REQUIRE(vq::equal(empty, vector_queue<int>()));
+}
+
+TEST_CASE("parallel algorithms")
+{
+	vq::parallel_policy policy{ 4, 8 };
+	vector_queue<int> q;
+	q.reserve(1000);
+	for (int i = 0; size_t(i) < q.capacity(); ++i)
+		q.push_back(i);
+	for (int i = 0; i < 300; ++i)
+	{
+		q.pop_front();
+		q.push_back(int(q.capacity()) + i);
+	}
+	for (size_t i = 0; i < q.size(); i += 7)
+	{
+		REQUIRE(vq::find(policy, q, q[i]) - q.begin() == ptrdiff_t(i));
+		REQUIRE(vq::find(vq::par, std::as_const(q), q[i]) - q.cbegin() == ptrdiff_t(i));
+	}
+	REQUIRE(vq::find(policy, q, -1) == q.end());
+	// the first of several matches in different chunks
+	REQUIRE(vq::find_if(policy, q, [](int v) { return v % 100 == 99; }) == std::find_if(q.begin(), q.end(), [](int v) { return v % 100 == 99; }));
+	REQUIRE(vq::count_if(policy, q, [](int v) { return v % 3 == 0; }) == size_t(std::count_if(q.begin(), q.end(), [](int v) { return v % 3 == 0; })));
+	REQUIRE(vq::count(policy, q, 500) == 1);
+	REQUIRE(vq::reduce(policy, q) == std::accumulate(q.begin(), q.end(), 0));
+	// not commutative, the chunks have to be combined in order
+	vector_queue<std::string> strings;
+	std::string expected;
+	for (int v : q)
+	{
+		strings.push_back(std::to_string(v % 10));
+		expected += strings.back();
+	}
+	REQUIRE(vq::reduce(policy, strings, std::string(">"), std::plus<>()) == ">" + expected);
+
+	std::vector<long long> out(q.size());
+	REQUIRE(vq::transform(policy, q, out.begin(), [](int v) { return (long long)v * 2; }) == out.end());
+	REQUIRE(std::equal(out.begin(), out.end(), q.begin(), [](long long a, int b) { return a == b * 2; }));
+	vq::transform(policy, q, [](int v) { return v + 1; });
+	vq::for_each(policy, q, [](int& v) { v *= 3; });
+	REQUIRE(q.front() == 301 * 3);
+	REQUIRE_THROWS_AS(vq::for_each(policy, q, [](int& v) { if (v == 3000) throw std::runtime_error("found"); }), std::runtime_error);
+
+	vector_queue<int> empty;
+	REQUIRE(vq::find(policy, empty, 1) == empty.end());
+	REQUIRE(vq::reduce(policy, empty, 5, std::plus<>()) == 5);
+}
+
+template <class T, class Compare = std::less<>>
+void check_sort(Compare comp = {})
+{
+	for (size_t size : { 0, 1, 10, 255, 300, 1000 })
+	{
+		// wrapped at different places so both ways of gathering the elements are used
+		for (size_t rotate : { size_t(0), size / 5, size / 2, size - size / 5 })
+		{
+			vector_queue<T> q;
+			q.reserve(size);
+			for (size_t i = 0; i < size; ++i)
+				q.push_back(T((i * 7919) % 2000) - T(700));
+			for (size_t i = 0; i < rotate; ++i)
+			{
+				q.push_back(q.front());
+				q.pop_front();
+			}
+			std::vector<T> expected(q.begin(), q.end());
+			std::sort(expected.begin(), expected.end(), comp);
+			auto parallel = q;
+			q.sort(comp);
+			REQUIRE(std::equal(q.begin(), q.end(), expected.begin(), expected.end()));
+			vq::sort(vq::parallel_policy{ 3, 16 }, parallel, comp);
+			REQUIRE(std::equal(parallel.begin(), parallel.end(), expected.begin(), expected.end()));
+		}
+	}
+}
+
+TEST_CASE("sort")
+{
+	check_sort<int32_t>();
+	check_sort<int32_t>(std::greater<>());
+	check_sort<int32_t>([](int32_t a, int32_t b) { return std::abs(a) < std::abs(b) || (std::abs(a) == std::abs(b) && a < b); });
+	check_sort<uint16_t>();
+	check_sort<int8_t>();
+	check_sort<int64_t>(std::less<int64_t>());
+	check_sort<uint64_t>();
+	check_sort<float>();
+	check_sort<double>(std::greater<double>());
+
+	vector_queue<double> special{ 1.5, -0.0, -1e300, 3.0, std::numeric_limits<double>::infinity(), -std::numeric_limits<double>::infinity() };
+	for (int i = 0; i < 300; ++i)
+		special.push_back(double(i % 17) - 8.5);
+	special.sort();
+	REQUIRE(std::is_sorted(special.begin(), special.end()));
+
+	vector_queue<std::string> strings;
+	for (int i = 0; i < 40; ++i)
+		strings.push_front(std::to_string(i));
+	strings.sort();
+	REQUIRE(std::is_sorted(strings.begin(), strings.end()));
+	REQUIRE(strings.front() == "0");
+	REQUIRE(strings.back() == "9");
+}
+
+TEST_CASE("sorted vector_queue")
+{
+	sorted_vector_queue<int> q;
+	std::multiset<int> expected;
+	REQUIRE(q.lower_bound_index(5) == 0);
+	REQUIRE(q.find(5) == q.end());
+	for (int i = 0; i < 2000; ++i)
+	{
+		// mostly near the back, sometimes near the front or anywhere
+		int value = i % 7 == 0 ? -i : i % 11 == 0 ? (i * 7919) % 2000 : i;
+		q.insert(value);
+		expected.insert(value);
+		if (i % 5 == 0)
+		{
+			REQUIRE(q.front() == *expected.begin());
+			q.pop_front();
+			expected.erase(expected.begin());
+		}
+	}
+	REQUIRE(std::equal(q.begin(), q.end(), expected.begin(), expected.end()));
+	for (int value : { -1995, -7, 0, 3, 500, 1001, 1998, 5000 })
+	{
+		REQUIRE(q.lower_bound(value) - q.begin() == std::distance(expected.begin(), expected.lower_bound(value)));
+		REQUIRE(q.upper_bound(value) - q.begin() == std::distance(expected.begin(), expected.upper_bound(value)));
+		REQUIRE(q.count(value) == expected.count(value));
+		REQUIRE(q.contains(value) == expected.contains(value));
+	}
+	REQUIRE(q.erase(500) == expected.erase(500));
+	REQUIRE(!q.contains(500));
+
+	std::vector<int> batch{ -3000, 10, 10, 700, 1500, 4000 };
+	q.merge_sorted(batch);
+	expected.insert(batch.begin(), batch.end());
+	REQUIRE(std::equal(q.begin(), q.end(), expected.begin(), expected.end()));
+	std::vector<int> big(q.size());
+	std::iota(big.begin(), big.end(), -1000);
+	q.merge_sorted(big.begin(), big.end());
+	expected.insert(big.begin(), big.end());
+	REQUIRE(std::equal(q.begin(), q.end(), expected.begin(), expected.end()));
+	std::vector<int> tail{ 5000, 5001 };
+	q.merge_sorted(tail);
+	REQUIRE(q.back() == 5001);
+	std::istringstream numbers("-5000 20 20 5001 6000");
+	q.merge_sorted(std::istream_iterator<int>(numbers), std::istream_iterator<int>());
+	REQUIRE(q.front() == -5000);
+	REQUIRE(q.back() == 6000);
+	REQUIRE(q.count(20) == expected.count(20) + 2);
+	REQUIRE(std::is_sorted(q.begin(), q.end()));
+
+	// equal elements keep their insertion order
+	sorted_vector_queue<std::pair<int, int>, std::function<bool(const std::pair<int, int>&, const std::pair<int, int>&)>> stable(
+		[](auto& a, auto& b) { return a.first < b.first; });
+	for (int i = 0; i < 50; ++i)
+		stable.emplace(i % 3, i);
+	for (size_t i = 1; i < stable.size(); ++i)
+		REQUIRE((stable[i - 1].first < stable[i].first || stable[i - 1].second < stable[i].second));
+	stable.merge_sorted(std::vector<std::pair<int, int>>{ { 1, 100 }, { 1, 101 } });
+	auto [first, last] = stable.equal_range({ 1, 0 });
+	REQUIRE((last - 1)->second == 101);
+	REQUIRE((last - 2)->second == 100);
+	REQUIRE(first->second == 1);
+}
+
+TEST_CASE("incremental growth")
+{
+	incremental_vector_queue<std::string> q;
+	std::deque<std::string> expected;
+	bool migrated = false;
+	uint32_t random = 12345;
+	for (int i = 0; i < 20000; ++i)
+	{
+		random = random * 1103515245 + 12345;
+		auto op = (random >> 16) % 10;
+		auto value = std::to_string(i);
+		if (op < 5)
+		{
+			q.push_back(value);
+			expected.push_back(value);
+		}
+		else if (op < 7)
+		{
+			q.push_front(value);
+			expected.push_front(value);
+		}
+		else if (op == 7 && !expected.empty())
+		{
+			q.pop_front();
+			expected.pop_front();
+		}
+		else if (op == 8 && !expected.empty())
+		{
+			q.pop_back();
+			expected.pop_back();
+		}
+		else if (!expected.empty())
+		{
+			// an element of the queue itself
+			q.push_back(q.front());
+			expected.push_back(expected.front());
+			q.push_front(q.back());
+			expected.push_front(expected.back());
+		}
+		migrated |= q.migrating();
+		REQUIRE(q.size() == expected.size());
+		if (!expected.empty())
+		{
+			REQUIRE(q.front() == expected.front());
+			REQUIRE(q.back() == expected.back());
+		}
+		if (i % 1000 == 0)
+			REQUIRE(std::equal(q.begin(), q.end(), expected.begin(), expected.end()));
+	}
+	REQUIRE(migrated);
+	REQUIRE(std::equal(q.cbegin(), q.cend(), expected.begin(), expected.end()));
+	q.finish_migration();
+	REQUIRE(!q.migrating());
+	REQUIRE(std::equal(q.begin(), q.end(), expected.begin(), expected.end()));
+	REQUIRE(q.release_retired() > 0);
+	REQUIRE(q.release_retired() == 0);
+	q.clear();
+	REQUIRE(q.empty());
+	q.push_front("a");
+	REQUIRE(q[0] == "a");
+
+	// an old buffer emptied by pops is retired too
+	incremental_vector_queue<int> popped;
+	for (int i = 0; i < 32; ++i)
+		popped.push_back(i);
+	popped.release_retired();
+	popped.push_back(32); // 28 left to migrate
+	popped.pop_front();
+	popped.pop_front();
+	for (int i = 33; i < 36; ++i)
+		popped.push_back(i);
+	popped.pop_front();
+	REQUIRE(popped.migrating()); // 1 left
+	popped.pop_front();
+	REQUIRE(!popped.migrating());
+	REQUIRE(popped.release_retired() == 1);
+	REQUIRE(popped.front() == 4);
+	REQUIRE(popped.back() == 35);
+}
+
+TEST_CASE("block storage")
+{
+	block_vector_queue<std::string, 4> q;
+	std::deque<std::string> expected;
+	std::vector<std::pair<const std::string*, std::string>> held;
+	uint32_t random = 777;
+	for (int i = 0; i < 5000; ++i)
+	{
+		random = random * 1103515245 + 12345;
+		auto op = (random >> 16) % 8;
+		auto value = std::to_string(i);
+		if (op < 3)
+		{
+			held.emplace_back(&q.emplace_back(value), value);
+			expected.push_back(value);
+		}
+		else if (op < 5)
+		{
+			held.emplace_back(&q.emplace_front(value), value);
+			expected.push_front(value);
+		}
+		else if (op == 5 && !expected.empty())
+		{
+			std::erase_if(held, [&](auto& h) { return h.first == &q.front(); });
+			q.pop_front();
+			expected.pop_front();
+		}
+		else if (op == 6 && !expected.empty())
+		{
+			std::erase_if(held, [&](auto& h) { return h.first == &q.back(); });
+			q.pop_back();
+			expected.pop_back();
+		}
+		REQUIRE(q.size() == expected.size());
+		REQUIRE(q.blocks() <= (q.size() + 6) / 4 + 1);
+	}
+	REQUIRE(std::equal(q.begin(), q.end(), expected.begin(), expected.end()));
+	// elements never moved
+	for (auto& [pointer, value] : held)
+		REQUIRE(*pointer == value);
+	block_vector_queue<std::string, 4> moved(std::move(q));
+	REQUIRE(q.empty());
+	REQUIRE(std::equal(moved.cbegin(), moved.cend(), expected.begin(), expected.end()));
+	while (!moved.empty())
+		moved.pop_front();
+	REQUIRE(moved.blocks() == 0);
+	static_assert(block_vector_queue<int>::block_size == 1024);
+	static_assert(block_vector_queue<std::array<char, 3000>>::block_size == 16);
+}
+
+template <class Policy>
+void check_growth(Policy policy = {})
+{
+	vector_queue<int, std::allocator<int>, Policy> q;
+	std::deque<int> expected;
+	size_t last_capacity = 0;
+	for (int i = 0; i < 2000; ++i)
+	{
+		switch (i % 7)
+		{
+		case 0: case 3: q.push_back(i); expected.push_back(i); break;
+		case 1: case 4: q.push_front(i); expected.push_front(i); break;
+		case 2: q.pop_front(); expected.pop_front(); break;
+		case 5:
+		{
+			int values[] = { -i, -i - 1, -i - 2 };
+			size_t pos = (i / 7) % (q.size() + 1);
+			q.insert(q.begin() + pos, std::begin(values), std::end(values));
+			expected.insert(expected.begin() + pos, std::begin(values), std::end(values));
+			break;
+		}
+		case 6:
+		{
+			size_t pos = (i / 7) % (q.size() + 1);
+			q.emplace(q.begin() + pos, i);
+			expected.insert(expected.begin() + pos, i);
+			break;
+		}
+		}
+		REQUIRE(q.size() <= q.capacity());
+		if (q.capacity() != last_capacity)
+		{
+			REQUIRE(q.capacity() >= policy.next_capacity(last_capacity, sizeof(int)));
+			if constexpr (Policy::power_of_two)
+				REQUIRE(std::has_single_bit(q.capacity()));
+			last_capacity = q.capacity();
+		}
+	}
+	REQUIRE(std::equal(q.begin(), q.end(), expected.begin(), expected.end()));
+	REQUIRE(std::equal(q.rbegin(), q.rend(), expected.rbegin(), expected.rend()));
+	REQUIRE(q.sum() == std::accumulate(expected.begin(), expected.end(), 0));
+	REQUIRE(q.find(expected[expected.size() / 2]) == q.begin() + expected.size() / 2);
+	REQUIRE(q.find_last_if([&](int value) { return value == expected.front(); }) == q.begin());
+
+	auto copy = q;
+	REQUIRE(copy.capacity() >= copy.size());
+	REQUIRE(std::equal(copy.begin(), copy.end(), expected.begin(), expected.end()));
+	copy.sort();
+	std::sort(expected.begin(), expected.end());
+	REQUIRE(std::equal(copy.begin(), copy.end(), expected.begin(), expected.end()));
+	vq::sort(vq::parallel_policy{ 4, 1 }, q);
+	REQUIRE(std::equal(q.begin(), q.end(), expected.begin(), expected.end()));
+
+	// insert at the front so it wraps around to the end of the buffer
+	vector_queue<int, std::allocator<int>, Policy> wrapped;
+	wrapped.reserve(7);
+	size_t capacity = wrapped.capacity();
+	wrapped.push_back(0);
+	for (size_t i = 1; i < capacity - 1; ++i)
+		wrapped.push_back(int(i));
+	wrapped.pop_front();
+	int front[] = { -2, -1 };
+	wrapped.insert(wrapped.begin(), std::begin(front), std::end(front));
+	REQUIRE(wrapped.capacity() == capacity);
+	REQUIRE(wrapped.size() == capacity);
+	REQUIRE(wrapped.front() == -2);
+	REQUIRE(wrapped[2] == 1);
+	REQUIRE(wrapped.back() == int(capacity) - 2);
+	wrapped.pop_back();
+	wrapped.push_front(-3);
+	REQUIRE(wrapped.front() == -3);
+	REQUIRE(wrapped.capacity() == capacity);
+}
+
+TEST_CASE("growth policies")
+{
+	check_growth<vq::double_growth>();
+	check_growth<vq::exact_growth>();
+	check_growth<vq::half_growth>();
+	check_growth<vq::page_growth<>>();
+	check_growth<vq::page_growth<100>>();
+	check_growth<vq::fixed_growth<5>>();
+
+	struct big { char bytes[200]; };
+	vector_queue<big, std::allocator<big>, vq::exact_growth> exact;
+	exact.reserve(1'000'001);
+	REQUIRE(exact.capacity() == 1'000'001);
+	vector_queue<int, std::allocator<int>, vq::exact_growth> doubled;
+	doubled.reserve(1001);
+	for (int i = 0; i < 1002; ++i)
+		doubled.push_back(i);
+	REQUIRE(doubled.capacity() == 2002);
+
+	vector_queue<uint64_t, std::allocator<uint64_t>, vq::half_growth> half;
+	half.reserve(3);
+	REQUIRE(half.capacity() == 3);
+	for (int i = 0; i < 4; ++i)
+		half.push_back(i);
+	REQUIRE(half.capacity() == 4);
+	half.push_back(4);
+	REQUIRE(half.capacity() == 6);
+
+	vector_queue<uint64_t, std::allocator<uint64_t>, vq::page_growth<>> paged;
+	paged.push_back(1);
+	REQUIRE(paged.capacity() == 512);
+	paged.reserve(513);
+	REQUIRE(paged.capacity() == 1024);
+
+	vector_queue<int, std::allocator<int>, vq::fixed_growth<10>> fixed{ 1, 2, 3 };
+	REQUIRE(fixed.capacity() == 3);
+	fixed.push_front(0);
+	REQUIRE(fixed.capacity() == 13);
+	REQUIRE(fixed.front() == 0);
+}
+
+TEST_CASE("compact header")
+{
+	using compact = vector_queue<int, std::allocator<int>, vq::double_growth, uint32_t>;
+	static_assert(sizeof(compact) == 16);
+	static_assert(sizeof(vector_queue<int>) == 32);
+
+	compact q;
+	std::deque<int> expected;
+	for (int i = 0; i < 5000; ++i)
+	{
+		if (i % 3 == 2)
+		{
+			q.pop_front();
+			expected.pop_front();
+		}
+		else if (i % 3 == 1)
+		{
+			q.push_front(i);
+			expected.push_front(i);
+		}
+		else
+		{
+			q.push_back(i);
+			expected.push_back(i);
+		}
+	}
+	REQUIRE(std::has_single_bit(q.capacity()));
+	REQUIRE(std::equal(q.begin(), q.end(), expected.begin(), expected.end()));
+	REQUIRE(q.find(expected[100]) == q.begin() + 100);
+	int values[] = { -1, -2, -3 };
+	q.insert(q.begin() + 10, std::begin(values), std::end(values));
+	expected.insert(expected.begin() + 10, std::begin(values), std::end(values));
+	q.emplace(q.end() - 10, -4);
+	expected.insert(expected.end() - 10, -4);
+	REQUIRE(std::equal(q.begin(), q.end(), expected.begin(), expected.end()));
+
+	auto copy = q;
+	copy.sort();
+	std::sort(expected.begin(), expected.end());
+	REQUIRE(std::equal(copy.begin(), copy.end(), expected.begin(), expected.end()));
+	copy.shrink_to_fit();
+	REQUIRE(copy.capacity() == std::bit_ceil(copy.size()));
+
+	REQUIRE(q.max_size() == size_t(1) << 27);
+#ifndef VECTOR_QUEUE_NO_EXCEPTIONS
+	vector_queue<char, std::allocator<char>, vq::double_growth, uint32_t> chars;
+	REQUIRE_THROWS_AS(chars.reserve((size_t(1) << 27) + 1), std::length_error);
+#endif
+}
+
+TEST_CASE("shrinking")
+{
+	vector_queue<std::string> q;
+	for (int i = 0; i < 50; ++i)
+		q.push_front(std::to_string(i));
+	for (int i = 0; i < 45; ++i)
+		q.pop_back();
+	REQUIRE(q.capacity() == 64);
+	q.shrink_to_fit();
+	REQUIRE(q.capacity() == 8);
+	REQUIRE(equals(q, { "49", "48", "47", "46", "45" }));
+	q.clear();
+	q.shrink_to_fit();
+	REQUIRE(q.capacity() == 0);
+	q.push_back("0");
+	REQUIRE(q.front() == "0");
+
+	vector_queue<int, std::allocator<int>, vq::exact_growth> exact{ 1, 2, 3 };
+	exact.reserve(100);
+	exact.shrink_to_fit();
+	REQUIRE(exact.capacity() == 3);
+	REQUIRE(equals(exact, { 1, 2, 3 }));
+
+	vector_queue<int, std::allocator<int>, vq::shrink_after_bursts<vq::double_growth, 16>> bursty;
+	std::deque<int> expected;
+	for (int i = 0; i < 1000; ++i)
+	{
+		bursty.push_back(i);
+		expected.push_back(i);
+	}
+	REQUIRE(bursty.capacity() == 1024);
+	while (bursty.size() > 256)
+	{
+		bursty.pop_front();
+		expected.pop_front();
+	}
+	// below a quarter of the capacity it takes 16 pops to halve it
+	for (int i = 0; i < 15; ++i)
+	{
+		bursty.pop_front();
+		expected.pop_front();
+	}
+	REQUIRE(bursty.capacity() == 1024);
+	bursty.pop_front();
+	expected.pop_front();
+	REQUIRE(bursty.capacity() == 512);
+	REQUIRE(std::equal(bursty.begin(), bursty.end(), expected.begin(), expected.end()));
+
+	// a drained queue shrinks down to the initial capacity and no further
+	for (int i = 0; i < 10000; ++i)
+	{
+		bursty.push_back(i);
+		bursty.pop_front();
+		expected.push_back(i);
+		expected.pop_front();
+		if (i % 2 && !bursty.empty())
+		{
+			bursty.pop_back();
+			expected.pop_back();
+		}
+	}
+	REQUIRE(bursty.empty());
+	REQUIRE(bursty.capacity() == vq::initial_capacity(sizeof(int)));
+
+	// each pop while the size is at least a quarter resets the count
+	vector_queue<int, std::allocator<int>, vq::shrink_after_bursts<vq::double_growth, 4>> steady;
+	for (int i = 0; i < 64; ++i)
+		steady.push_back(i);
+	for (int i = 0; i < 48; ++i)
+		steady.pop_front();
+	for (int i = 0; i < 100; ++i)
+	{
+		steady.pop_front();
+		steady.pop_front();
+		steady.pop_front();
+		for (int j = 0; j < 4; ++j)
+			steady.push_back(j);
+		steady.pop_front();
+	}
+	REQUIRE(steady.capacity() == 64);
+}
+
+TEST_CASE("size class allocator")
+{
+	using allocator = size_class_allocator<int>;
+	allocator::release_cached();
+	auto before = allocator::stats();
+	for (int round = 0; round < 10; ++round)
+	{
+		vector_queue<int, allocator> q;
+		for (int i = 0; i < 1000; ++i)
+			q.push_back(i);
+		q.pop_front();
+		REQUIRE(q.front() == 1);
+		REQUIRE(q.capacity() == 1024);
+	}
+	// the first round misses on each of the 9 capacities from 4 to 1024, the others hit
+	auto after = allocator::stats();
+	REQUIRE(after.misses - before.misses == 9);
+	REQUIRE(after.hits - before.hits == 81);
+	REQUIRE(after.recycled - before.recycled == 90);
+	REQUIRE(after.hit_rate() > 0.0);
+
+	// the cache is per size in bytes, not per type
+	vector_queue<float, size_class_allocator<float>> floats{ 1.0f, 2.0f, 3.0f, 4.0f };
+	REQUIRE(allocator::stats().hits == after.hits + 1);
+
+	size_class_stats other;
+	std::thread([&]
+		{
+			vector_queue<int, allocator> q{ 1, 2, 3 };
+			other = allocator::stats();
+		}).join();
+	REQUIRE(other.hits == 0);
+	REQUIRE(other.misses == 1);
+
+	// at most MaxCached buffers of a size are kept and larger buffers than MaxBytes aren't cached,
+	// in a cache of its own for these parameters
+	auto shared = allocator::stats();
+	using small = size_class_allocator<char, 64, 2>;
+	small::release_cached();
+	before = small::stats();
+	small alloc;
+	char* buffers[] = { alloc.allocate(10), alloc.allocate(16), alloc.allocate(9), alloc.allocate(100) };
+	for (auto buffer : buffers)
+		buffer[0] = 'x';
+	alloc.deallocate(buffers[0], 10);
+	alloc.deallocate(buffers[1], 16);
+	alloc.deallocate(buffers[2], 9);
+	alloc.deallocate(buffers[3], 100);
+	after = small::stats();
+	REQUIRE(after.misses - before.misses == 3);
+	REQUIRE(after.recycled - before.recycled == 2);
+	REQUIRE(after.released - before.released == 1);
+	small::release_cached();
+	REQUIRE(allocator::stats().misses == shared.misses);
+	REQUIRE(allocator::stats().recycled == shared.recycled);
+}
+
+template <class T, bool Propagate>
+struct tagged_allocator
+{
+	using value_type = T;
+	using propagate_on_container_copy_assignment = std::bool_constant<Propagate>;
+	using propagate_on_container_move_assignment = std::bool_constant<Propagate>;
+	using propagate_on_container_swap = std::bool_constant<Propagate>;
+	using is_always_equal = std::false_type;
+
+	int id = 0;
+
+	tagged_allocator(int id = 0) : id(id) {}
+	template <class U>
+	tagged_allocator(const tagged_allocator<U, Propagate>& other) : id(other.id) {}
+	template <class U>
+	struct rebind { using other = tagged_allocator<U, Propagate>; };
+
+	T* allocate(size_t n) { return std::allocator<T>().allocate(n); }
+	void deallocate(T* p, size_t n) { std::allocator<T>().deallocate(p, n); }
+	tagged_allocator select_on_container_copy_construction() const { return Propagate ? id : -1; }
+	friend bool operator==(const tagged_allocator& a, const tagged_allocator& b) { return a.id == b.id; }
+};
+
+template <bool Propagate>
+void check_propagation()
+{
+	using queue = vector_queue<std::string, tagged_allocator<std::string, Propagate>>;
+	queue a({ "a", "b", "c" }, 1);
+	queue b({ "x" }, 2);
+
+	queue copy(a);
+	REQUIRE(copy.get_allocator().id == (Propagate ? 1 : -1));
+	queue copy_with(a, 3);
+	REQUIRE(copy_with.get_allocator().id == 3);
+	REQUIRE(equals(copy_with, { "a", "b", "c" }));
+
+	b = a;
+	REQUIRE(b.get_allocator().id == (Propagate ? 1 : 2));
+	REQUIRE(equals(b, { "a", "b", "c" }));
+
+	queue c({ "y" }, 4);
+	c = std::move(b);
+	REQUIRE(c.get_allocator().id == (Propagate ? 1 : 4));
+	REQUIRE(equals(c, { "a", "b", "c" }));
+	REQUIRE(b.empty());
+
+	queue moved(std::move(c), 5);
+	REQUIRE(moved.get_allocator().id == 5);
+	REQUIRE(equals(moved, { "a", "b", "c" }));
+	REQUIRE(c.empty());
+	moved.push_front("0");
+	moved.insert(moved.begin() + 2, "1");
+	REQUIRE(equals(moved, { "0", "a", "1", "b", "c" }));
+}
+
+TEST_CASE("allocators")
+{
+	check_propagation<true>();
+	check_propagation<false>();
+
+	// everything, including the temporary buffers of insert and emplace, comes from the resource
+	std::vector<std::byte> storage(1 << 16);
+	std::pmr::monotonic_buffer_resource resource(storage.data(), storage.size(), std::pmr::null_memory_resource());
+	auto previous = std::pmr::set_default_resource(std::pmr::null_memory_resource());
+	{
+		vq::pmr::vector_queue<int> q(&resource);
+		for (int i = 0; i < 100; ++i)
+			q.push_front(i);
+		int values[] = { -1, -2, -3 };
+		while (q.size() < q.capacity())
+			q.push_back(0);
+		q.insert(q.begin() + 10, std::begin(values), std::end(values));
+		while (q.size() < q.capacity())
+			q.push_back(0);
+		q.emplace(q.begin() + 50, -4);
+		REQUIRE(q[10] == -1);
+		REQUIRE(q[50] == -4);
+		q.shrink_to_fit();
+		REQUIRE(q.get_allocator().resource() == &resource);
+
+		vq::pmr::vector_queue<std::pmr::string> strings(&resource);
+		strings.emplace_back("a string that is too long for the small string buffer");
+		strings.emplace_front("another string that is too long for the small string buffer");
+		REQUIRE(strings[0].get_allocator().resource() == &resource);
+		REQUIRE(strings[1].get_allocator().resource() == &resource);
+
+		vq::pmr::vector_queue<vq::pmr::vector_queue<int>> nested(&resource);
+		nested.emplace_back();
+		nested.back().push_back(1);
+		REQUIRE(nested.back().get_allocator().resource() == &resource);
+	}
+	std::pmr::set_default_resource(previous);
+
+	// a parallel sort doesn't call the (unsynchronized) allocator, not even for its scratch buffer
+	struct counting_resource : std::pmr::memory_resource
+	{
+		size_t calls = 0;
+		void* do_allocate(size_t bytes, size_t alignment) override
+		{
+			++calls;
+			return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+		}
+		void do_deallocate(void* p, size_t bytes, size_t alignment) override
+		{
+			++calls;
+			std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+		}
+		bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+	} counting;
+	vq::pmr::vector_queue<int> q(&counting);
+	for (int i = 0; i < 10000; ++i)
+		q.push_front(i * 7919 % 10007);
+	size_t calls = counting.calls;
+	vq::sort(vq::parallel_policy{ 4, 1000 }, q);
+	REQUIRE(counting.calls == calls);
+	REQUIRE(std::is_sorted(q.begin(), q.end()));
+}
+
+TEST_CASE("queue pool")
+{
+	vector_queue_pool pool(1 << 16);
+	std::vector<vector_queue_pool::queue<int>> queues;
+	std::vector<std::deque<int>> expected(1000);
+	for (int i = 0; i < 1000; ++i)
+		queues.push_back(pool.make_queue<int>());
+	for (int round = 0; round < 40; ++round)
+	{
+		for (size_t i = 0; i < queues.size(); ++i)
+		{
+			if ((i + round) % 5 == 0 && !queues[i].empty())
+			{
+				queues[i].pop_front();
+				expected[i].pop_front();
+			}
+			else if (size_t(round) < 2 * (i % 16))
+			{
+				queues[i].push_back(round);
+				expected[i].push_back(round);
+			}
+		}
+	}
+	for (size_t i = 0; i < queues.size(); ++i)
+		REQUIRE(std::equal(queues[i].begin(), queues[i].end(), expected[i].begin(), expected[i].end()));
+	REQUIRE(pool.slab_count() > 1);
+	REQUIRE(pool.used_bytes() <= pool.reserved_bytes());
+	REQUIRE(pool.compact() == 0);
+
+	// a queue moved or copied keeps allocating from the pool
+	auto moved = std::move(queues[15]);
+	auto copy = moved;
+	copy.push_front(-1);
+	REQUIRE(copy.get_allocator() == moved.get_allocator());
+	REQUIRE(copy.front() == -1);
+
+	// copies of empty queues don't take a block
+	size_t before_copies = pool.used_bytes();
+	auto empty = pool.make_queue<int>();
+	auto empty_copy = empty;
+	vector_queue_pool::queue<int> empty_moved(std::move(empty_copy), empty.get_allocator());
+	vector_queue_pool::queue<int> empty_list({}, empty.get_allocator());
+	REQUIRE(pool.used_bytes() == before_copies);
+
+	// buffers larger than a sixteenth of a slab come from the heap
+	size_t used = pool.used_bytes();
+	auto large = pool.make_queue<int64_t>();
+	large.reserve(1024);
+	REQUIRE(pool.used_bytes() == used);
+
+	size_t slabs = pool.slab_count();
+	queues.clear();
+	moved = pool.make_queue<int>();
+	copy = pool.make_queue<int>();
+	REQUIRE(pool.used_bytes() == 0);
+	REQUIRE(pool.compact() == slabs);
+	REQUIRE(pool.slab_count() == 0);
+
+	// the pool works after compacting
+	auto q = pool.make_queue<std::string>();
+	for (int i = 0; i < 100; ++i)
+		q.push_back(std::to_string(i));
+	REQUIRE(q[99] == "99");
+	REQUIRE(pool.slab_count() > 0);
+
+	// compact(queues) moves the queues out of sparse slabs, 1023 blocks of 64 bytes fit in a slab
+	vector_queue_pool sparse(1 << 16);
+	std::vector<vector_queue_pool::queue<int>> kept;
+	for (int i = 0; i < 4000; ++i)
+	{
+		kept.push_back(sparse.make_queue<int>());
+		kept.back().reserve(16);
+		for (int j = 0; j < 16; ++j)
+			kept.back().push_back(i + j);
+	}
+	REQUIRE(sparse.slab_count() == 4);
+	std::erase_if(kept, [](auto& small) { return small.front() % 4 != 0; });
+	REQUIRE(sparse.compact() == 0);
+	// a queue left out keeps its slab
+	auto left_out = std::move(kept.back());
+	kept.pop_back();
+	REQUIRE(sparse.compact(kept) == 2);
+	REQUIRE(sparse.slab_count() == 2);
+	REQUIRE(left_out[15] == 3996 + 15);
+	for (size_t i = 0; i < kept.size(); ++i)
+	{
+		REQUIRE(kept[i].size() == 16);
+		REQUIRE(kept[i].front() == int(i * 4));
+		REQUIRE(kept[i].back() == int(i * 4 + 15));
+	}
+	// the free blocks of the slab that was kept are used again
+	for (int i = 0; i < 1000; ++i)
+		kept.emplace_back(sparse.make_queue<int>()).push_back(i);
+	REQUIRE(sparse.slab_count() == 2);
+	REQUIRE(sparse.compact(kept) == 0);
+}
+
+template <class Alloc>
+void check_huge_pages()
+{
+	auto aligned = [](const void* p, size_t alignment) { return reinterpret_cast<uintptr_t>(p) % alignment == 0; };
+	vector_queue<int32_t, Alloc> q;
+	q.push_back(0);
+	REQUIRE(aligned(&q.front(), 64));
+	// 2^20 elements are 4 MB, above the threshold
+	for (int32_t i = 1; i < (1 << 20); ++i)
+		q.push_back(i);
+	REQUIRE(q.capacity() == 1 << 20);
+	REQUIRE(aligned(&q.front(), size_t(1) << 21));
+	q.pop_front();
+	q.push_back(-1);
+	REQUIRE(q.find(-1) == q.end() - 1);
+	REQUIRE(q.sum() == int32_t(((int64_t(1) << 20) * ((1 << 20) - 1) / 2 - 1) & 0xffffffff));
+	q.push_back(-2);
+	REQUIRE(q.capacity() == 1 << 21);
+	REQUIRE(q.back() == -2);
+}
+
+TEST_CASE("huge page allocator")
+{
+	check_huge_pages<huge_page_allocator<int32_t>>();
+	check_huge_pages<huge_page_allocator<int32_t, size_t(1) << 21, 64, true>>();
+
+	huge_page_allocator<char, 1 << 16, 128> alloc;
+	char* small = alloc.allocate(100);
+	char* large = alloc.allocate(1 << 16);
+	REQUIRE(reinterpret_cast<uintptr_t>(small) % 128 == 0);
+	REQUIRE(reinterpret_cast<uintptr_t>(large) % (1 << 21) == 0);
+	large[(1 << 16) - 1] = small[99] = 'x';
+	alloc.deallocate(small, 100);
+	alloc.deallocate(large, 1 << 16);
+}
+
+TEST_CASE("insert front/back")
+{
+	vector_queue<int> q;
+	q.push_front(1);
+	q.push_back(4);
+	q.insert(q.begin() + 1, 2);
+	q.insert(q.begin() + 2, 3);
+	REQUIRE(equals(q, { 1,2,3,4 }));
+	q.push_back(8);
+	q.insert(q.end() - 1, 7);
+	q.insert(q.end() - 2, 6);
+	q.insert(q.end() - 3, 5);
+	REQUIRE(equals(q, { 1,2,3,4,5,6,7,8 }));
+}
+
+TEST_CASE("iterators")
+{
+	static_assert(std::random_access_iterator<vector_queue<int>::iterator>);
+	static_assert(std::random_access_iterator<vector_queue<int>::const_iterator>);
+	vector_queue<int> q;
+	q.reserve(16);
+	for (int i = 0; i < 16; ++i)
+		q.push_back(i);
+	for (int i = 0; i < 10; ++i)
+	{
+		q.pop_front();
+		q.push_back(16 + i);
+	}
+	// full and wrapped, begin and end share a slot
+	int expected = 10;
+	for (int v : q)
+		REQUIRE(v == expected++);
+	REQUIRE(expected == 26);
+	REQUIRE(q.end() - q.begin() == 16);
+	REQUIRE(q.begin() != q.end());
+	for (ptrdiff_t i = 0; i < 16; ++i)
+	{
+		REQUIRE(q.begin()[i] == 10 + i);
+		REQUIRE(*(q.end() - (16 - i)) == 10 + i);
+		auto it = q.end();
+		for (ptrdiff_t j = 16; j > i; --j)
+			--it;
+		REQUIRE(it == q.begin() + i);
+		REQUIRE(*it == 10 + i);
+	}
+	auto [lo, hi] = std::minmax_element(q.cbegin(), q.cend());
+	REQUIRE(*lo == 10);
+	REQUIRE(*hi == 25);
+	std::sort(q.begin(), q.end(), std::greater<>());
+	REQUIRE(q.front() == 25);
+	REQUIRE(q.back() == 10);
+
+	// elements shift towards the back when inserting past the middle
+	vector_queue<int> r{ 0, 1, 2, 3, 4, 5 };
+	std::vector<int> values{ 10, 11 };
+	r.insert(r.begin() + 4, values.begin(), values.end());
+	REQUIRE(equals(r, { 0, 1, 2, 3, 10, 11, 4, 5 }));
+	r.pop_back();
+	r.pop_back();
+	r.insert(r.begin() + 1, values.begin(), values.end());
+	REQUIRE(equals(r, { 0, 10, 11, 1, 2, 3, 10, 11 }));
+}
+TEST_CASE("streambuf")
+{
+	vector_queue<char> q;
+	for (char c : std::string("0123456789abcd"))
+		q.push_back(c);
+	for (int i = 0; i < 10; ++i)
+		q.pop_front();
+	vector_queue_streambuf buf(q);
+	std::ostream out(&buf);
+	std::istream in(&buf);
+	out << "hello world " << 42 << std::flush;
+	REQUIRE(q.size() == 18);
+	REQUIRE(q.capacity() == 32);
+	std::string word;
+	in >> word;
+	REQUIRE(word == "abcdhello");
+	in >> word;
+	REQUIRE(word == "world");
+	int number = 0;
+	in >> number;
+	REQUIRE(number == 42);
+	REQUIRE(q.empty());
+	in.clear();
+	out << "wrap around the end of the buffer" << std::flush;
+	std::string line;
+	std::getline(in, line);
+	REQUIRE(line == "wrap around the end of the buffer");
+
+	// a copy of an empty queue has no buffer until the stream writes to it
+	vector_queue<char> empty;
+	auto copy = empty;
+	REQUIRE(copy.capacity() == 0);
+	vector_queue_streambuf copy_buf(copy);
+	std::ostream copy_out(&copy_buf);
+	copy_out << "hello" << std::flush;
+	REQUIRE(copy.size() == 5);
+}
+
+TEST_CASE("record queue")
+{
+	record_queue<> q;
+	std::deque<std::vector<std::byte>> expected;
+	auto make_record = [](size_t size, int seed)
+	{
+		std::vector<std::byte> record(size);
+		for (size_t i = 0; i < size; ++i)
+			record[i] = std::byte(seed + i);
+		return record;
+	};
+	for (int i = 0; i < 200; ++i)
+	{
+		auto record = make_record((i * 37) % 90, i);
+		if (i % 3 == 0)
+		{
+			auto payload = q.emplace(record.size());
+			REQUIRE(payload.size() == record.size());
+			REQUIRE(reinterpret_cast<uintptr_t>(payload.data()) % 8 == 0);
+			std::copy(record.begin(), record.end(), payload.begin());
+		}
+		else
+		{
+			q.push(record);
+		}
+		expected.push_back(record);
+		if (i % 2 == 0)
+		{
+			REQUIRE(std::ranges::equal(q.front(), expected.front()));
+			q.pop();
+			expected.pop_front();
+		}
+		REQUIRE(q.size() == expected.size());
+	}
+	auto capacity = q.capacity_bytes();
+	while (!q.empty())
+	{
+		REQUIRE(std::ranges::equal(q.front(), expected.front()));
+		q.pop();
+		expected.pop_front();
+	}
+	for (int i = 0; i < 1000; ++i)
+	{
+		q.push(make_record(i % 50, i));
+		REQUIRE(std::ranges::equal(q.front(), make_record(i % 50, i)));
+		q.pop();
+	}
+	REQUIRE(q.capacity_bytes() == capacity);
+	REQUIRE(q.bytes() == 0);
+}
+
+TEST_CASE("task queue")
+{
+	task_queue<> q;
+	std::vector<std::string> log;
+	auto counter = std::make_shared<int>(0);
+	for (int i = 0; i < 20; ++i)
+	{
+		if (i % 2)
+			q.emplace_back([&log, i] { log.push_back(std::to_string(i)); });
+		else
+			q.emplace_back([&log, text = std::string(i * 3, 'x'), counter] { log.push_back(text); });
+	}
+	REQUIRE(q.size() == 20);
+	for (int i = 0; i < 10; ++i)
+		q.invoke_front();
+	REQUIRE(log.size() == 10);
+	REQUIRE(log[1] == "1");
+	REQUIRE(log[2] == "xxxxxx");
+	q.pop_front();
+	REQUIRE(q.size() == 9);
+	REQUIRE(log.size() == 10);
+
+	struct alignas(32) over_aligned
+	{
+		std::vector<std::string>* log;
+		void operator()() const { log->push_back("aligned"); }
+	};
+	q.emplace_back(over_aligned{ &log });
+
+	// tasks pushing tasks while the ring grows
+	int depth = 0;
+	std::function<void()> spawn = [&]
+	{
+		if (++depth < 100)
+		{
+			for (int i = 0; i < 3; ++i)
+				q.emplace_back([&log, counter, i] { log.push_back("child" + std::to_string(i)); });
+			q.emplace_back(spawn);
+		}
+	};
+	q.emplace_back(spawn);
+	while (!q.empty())
+		q.invoke_front();
+	REQUIRE(depth == 100);
+	REQUIRE(std::count(log.begin(), log.end(), "aligned") == 1);
+	REQUIRE(std::count(log.begin(), log.end(), "child0") == 99);
+	REQUIRE(log.back() == "child2");
+
+	// a task growing the ring several times while it runs
+	task_queue<> fresh;
+	fresh.emplace_back([&fresh, &log, counter]
+		{
+			for (int i = 0; i < 100; ++i)
+				fresh.emplace_back([&log, i] { log.push_back("fresh" + std::to_string(i)); });
+		});
+	while (!fresh.empty())
+		fresh.invoke_front();
+	REQUIRE(log.back() == "fresh99");
+
+	for (int i = 0; i < 5; ++i)
+		q.emplace_back([counter] {});
+	q.clear();
+	REQUIRE(counter.use_count() == 1);
+}
+
+TEST_CASE("reorder buffer")
+{
+	reorder_buffer<std::string> r(1000);
+	std::vector<std::string> out;
+	auto collect = [&out](std::string&& s) { out.push_back(std::move(s)); };
+	REQUIRE(r.insert_at_seq(1002, "c"));
+	REQUIRE(r.insert_at_seq(1001, "b"));
+	REQUIRE(r.ready() == 0);
+	REQUIRE(r.pop_ready(collect) == 0);
+	REQUIRE(r.insert_at_seq(1000, "a"));
+	REQUIRE_FALSE(r.insert_at_seq(1001, "duplicate"));
+	REQUIRE(r.pop_ready(collect) == 3);
+	REQUIRE(r.base_seq() == 1003);
+	REQUIRE_FALSE(r.insert_at_seq(1000, "late"));
+
+	// fill 300 slots in reverse so the filled prefix spans several bitmap words
+	out.clear();
+	for (uint64_t seq = 1302; seq > 1003; --seq)
+		REQUIRE(r.insert_at_seq(seq, std::to_string(seq)));
+	REQUIRE(r.ready() == 0);
+	REQUIRE(r.size() == 300);
+	REQUIRE(*r.at_seq(1100) == "1100");
+	REQUIRE(r.insert_at_seq(1003, "1003"));
+	REQUIRE(r.ready() == 300);
+	REQUIRE(r.pop_ready(collect) == 300);
+	for (size_t i = 0; i < out.size(); ++i)
+		REQUIRE(out[i] == std::to_string(1003 + i));
+
+	// a lost value is skipped
+	REQUIRE(r.insert_at_seq(1305, "1305"));
+	REQUIRE(r.insert_at_seq(1304, "1304"));
+	REQUIRE(r.ready() == 0);
+	r.skip_to(1304);
+	REQUIRE(r.ready() == 2);
+	REQUIRE(r.contains(1305));
+	r.skip_to(2000);
+	REQUIRE(r.empty());
+	REQUIRE(r.insert_at_seq(2000, "2000"));
+	REQUIRE(r.ready() == 1);
+
+	// a sequence number beyond the window is rejected without allocating the slots before it
+	REQUIRE(r.max_window() == reorder_buffer<std::string>::default_max_window);
+	REQUIRE_FALSE(r.insert_at_seq(2000 + (uint64_t(1) << 40), "bogus"));
+	REQUIRE(r.size() == 1);
+	reorder_buffer<int> narrow(0, 8);
+	REQUIRE(narrow.insert_at_seq(7, 7));
+	REQUIRE_FALSE(narrow.insert_at_seq(8, 8));
+	REQUIRE(narrow.size() == 8);
+
+	// with an allocator that has no default constructor
+	vector_queue_pool pool(1 << 16);
+	reorder_buffer<int, vector_queue_pool::allocator<int>> pooled(10, vector_queue_pool::allocator<int>(pool));
+	REQUIRE(pooled.insert_at_seq(11, 11));
+	REQUIRE(pooled.insert_at_seq(10, 10));
+	REQUIRE(pool.used_bytes() > 0);
+	const auto& const_pooled = pooled;
+	REQUIRE(*const_pooled.at_seq(11) == 11);
+	REQUIRE(const_pooled.at_seq(12) == nullptr);
+	REQUIRE(pooled.pop_ready([](int) {}) == 2);
+}
+
+TEST_CASE("sequence numbers")
+{
+	sequenced_vector_queue<int> q(1000000);
+	for (int i = 0; i < 10; ++i)
+		q.push_back(i);
+	REQUIRE(q.first_seq() == 1000000);
+	REQUIRE(q.last_seq() == 1000009);
+	for (int i = 0; i < 4; ++i)
+		q.pop_front();
+	REQUIRE(q.first_seq() == 1000004);
+	REQUIRE(q.at_seq(1000004) == 4);
+	REQUIRE(q.at_seq(1000009) == 9);
+	REQUIRE(q.seq_of(q.find(7)) == 1000007);
+	REQUIRE(q.seq_of(q.cbegin() + 2) == 1000006);
+	REQUIRE_FALSE(q.contains_seq(1000003));
+	REQUIRE_FALSE(q.contains_seq(1000010));
+	REQUIRE(q.find_seq(1000010) == q.end());
+	q.push_front(3);
+	REQUIRE(q.first_seq() == 1000003);
+	REQUIRE(q.at_seq(1000003) == 3);
+	REQUIRE(q.at_seq(1000009) == 9);
+	q.clear();
+	REQUIRE(q.first_seq() == 1000010);
+	q.push_back(10);
+	REQUIRE(q.at_seq(1000010) == 10);
+	sequenced_vector_queue<int> moved = std::move(q);
+	REQUIRE(moved.first_seq() == 1000010);
+}
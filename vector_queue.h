@@ -1,779 +1,2040 @@
-#pragma once
-/*
-Copyright (c) 2021 Christian Olsson
-
-Permission is hereby granted, free of charge, to any person obtaining a copy
-of this software and associated documentation files (the "Software"), to deal
-in the Software without restriction, including without limitation the rights
-to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
-copies of the Software, and to permit persons to whom the Software is
-furnished to do so, subject to the following conditions:
-
-The above copyright notice and this permission notice shall be included in all
-copies or substantial portions of the Software.
-
-THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
-IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
-FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
-AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
-LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
-OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
-SOFTWARE.
-*/
-
-
-#include <type_traits>
-#include <memory>
-#include <iterator>
-#include <algorithm>
-#include <bit>
-#ifdef VECTOR_QUEUE_HAS_SSE
-#include <pmmintrin.h>
-#include <emmintrin.h>
-#endif
-template <class T, class Alloc = std::allocator<T>>
-struct vector_queue
-{
-	template <class V> struct iter_templ;
-	using allocator_type = Alloc;
-	using value_type = T;
-	using reference = T&;
-	using const_reference = const T&;
-	using iterator = iter_templ<T>;
-	using const_iterator = iter_templ<const T>;
-	using reverse_iterator = std::reverse_iterator<iterator>;
-	using const_reverse_iterator = std::reverse_iterator<const_iterator>;
-	using difference_type = ptrdiff_t;
-
-	constexpr vector_queue() noexcept(noexcept(Alloc())) : array{}, _size{}, _capacity{}, start{}, alloc{}
-	{}
-	constexpr explicit vector_queue(const Alloc& alloc) noexcept : array{}, _size{}, _capacity{}, start{}, alloc{ alloc }
-	{}
-	vector_queue(std::initializer_list<T> values, const Alloc& alloc = Alloc()) : _size{}, _capacity(round_up(values.size())), start{}, alloc(alloc)
-	{
-		array = this->alloc.allocate(values.size());
-		for (auto& val : values)
-		{
-			std::construct_at(&array[_size++], val);
-		}
-	}
-
-	vector_queue(vector_queue<T>&& other) noexcept : array(other.array), _size(other._size), _capacity(other._capacity), start(other.start), alloc(std::move(other.alloc))
-	{
-		other._size = 0;
-		other.array = nullptr;
-		other._capacity = 0;
-	}
-
-	vector_queue(const vector_queue<T>& other) : _size{}, _capacity(other._size), start{}, alloc(other.alloc)
-	{
-		array = alloc.allocate(capacity());
-		for (auto& val : other)
-		{
-			std::construct_at(&array[_size++], val);
-		}
-	}
-
-	vector_queue<T, Alloc>& operator=(vector_queue<T, Alloc>&& other) noexcept
-	{
-		if (this == &other)
-			return *this;
-		swap(other);
-		other.clear();
-		return *this;
-	}
-
-	vector_queue<T, Alloc>& operator=(const vector_queue<T, Alloc>& other)
-	{
-		if (this == &other)
-			return *this;
-
-		clear();
-		if (capacity() < other.size()) {
-			alloc.deallocate(array, capacity());
-			_capacity = 0;
-			array = alloc.allocate(other.size());
-			_capacity = other.size();
-		}
-		for (auto& val : other)
-		{
-			std::construct_at(&array[_size++], val);
-		}
-		return *this;
-	}
-
-	iterator find(const T& value)
-	{
-#ifdef VECTOR_QUEUE_HAS_SSE
-		if (sizeof(T) > sizeof(uint32_t) || size() * sizeof(T) < 32 || !std::is_integral_v<T>)
-#endif
-		{
-			if (start + size() > capacity())
-			{
-				for (size_t i = start; i < capacity(); ++i)
-					if (array[i] == value)
-						return { i - start, *this };
-				auto processed = capacity() - start;
-				for (size_t i = 0; i < size() - processed; ++i)
-					if (array[i] == value)
-						return { i + processed, *this };
-				return end();
-			}
-
-			for (size_t i = 0; i < size(); ++i)
-				if (array[i + start] == value)
-					return { i, *this };
-			return end();
-		}
-#ifdef VECTOR_QUEUE_HAS_SSE
-		constexpr size_t stride = 16 / sizeof(T);
-		start = start & (capacity() - 1);
-		size_t aligned = (start + stride) & ~(stride-1);
-		for (size_t i = start; i < aligned; ++i)
-			if (array[i] == value)
-				return { i - start, *this };
-		while (size() - (aligned - start) > stride)
-		{
-			aligned &= (capacity() - 1);
-			auto res = find_value_sse(aligned, (std::make_signed_t<T>)value);
-			if(res)
-			{
-				return { aligned + (std::countr_zero((unsigned)res) / sizeof(T)) - start, *this };
-			}
-			aligned += stride;
-		}
-		iterator it = { aligned - start, *this };
-		return std::find(it, end(), value);
-#endif
-	}
-
-	iterator begin() { return { 0, *this }; }
-	iterator end() { return { _size, *this }; }
-	const_iterator begin() const { return { 0, *this }; }
-	const_iterator end() const { return { _size, *this }; }
-	const_iterator cbegin() const { return { 0, *this }; }
-	const_iterator cend() const { return { _size, *this }; }
-	reverse_iterator rbegin() { return reverse_iterator{ iterator{ _size, *this} }; }
-	reverse_iterator rend() { return reverse_iterator{ iterator{ 0, *this} }; }
-	const_reverse_iterator crbegin() const { return const_reverse_iterator{ const_iterator{ _size, *this} }; }
-	const_reverse_iterator crend() const { return const_reverse_iterator{ const_iterator{ 0, *this} }; }
-
-	constexpr bool empty() const
-	{
-		return size() == 0;
-	}
-
-	T& front()
-	{
-		return (*this)[0];
-	}
-
-	const T& front() const
-	{
-		return (*this)[0];
-	}
-
-	T& back()
-	{
-		return (*this)[size() - 1];
-	}
-
-	const T& back() const
-	{
-		return (*this)[size() - 1];
-	}
-
-	constexpr size_t wrap_up(size_t index) const
-	{
-		return (start + index) & (capacity() - 1);
-	}
-
-	constexpr size_t wrap_down(size_t index) const
-	{
-		return (start - index) & (capacity() - 1);
-	}
-
-
-	T& operator[](size_t index)
-	{
-		return array[wrap_up(index)];
-	}
-
-	const T& operator[](size_t index) const
-	{
-		return array[wrap_up(index)];
-	}
-
-
-	template <class... Args, class = std::enable_if_t<std::is_constructible_v<T, Args...>>>
-	void emplace_back(Args&&... args)
-	{
-		if (size() == capacity()) {
-			grow();
-			std::construct_at(&array[_size], std::forward<Args>(args)...);
-			++_size;
-		}
-		else
-		{
-			emplace_back_no_grow(std::forward<Args>(args)...);
-		}
-	}
-
-	void push_back(const T& value)
-	{
-		emplace_back(value);
-	}
-
-	void push_back(T&& value)
-	{
-		emplace_back(std::move(value));
-	}
-
-	template <class... Args, class = std::enable_if_t<std::is_constructible_v<T, Args...>>>
-	void emplace_front(Args&&... args)
-	{
-		if (size() == capacity()) {
-			grow();
-			std::construct_at(&array[capacity() - 1], std::forward<Args>(args)...); // wrap around
-			start = capacity() - 1;
-			++_size;
-		}
-		else
-		{
-			emplace_front_no_grow(std::forward<Args>(args)...);
-		}
-	}
-
-	void push_front(const T& value)
-	{
-		emplace_front(value);
-	}
-
-	void push_front(T&& value)
-	{
-		emplace_front(std::move(value));
-	}
-
-	void clear()
-	{
-		for_each_index([this](size_t ix)
-			{
-				std::destroy_at(&array[ix]);
-			});
-		start = 0;
-		_size = 0;
-	}
-
-	void reserve(size_t new_capacity)
-	{
-		if (new_capacity > capacity()) {
-			realloc(round_up(new_capacity));
-		}
-	}
-
-	void pop_front()
-	{
-		std::destroy_at(&(*this)[0]);
-		start++;
-		if (start == capacity())
-			start = 0;
-		--_size;
-	}
-
-	void pop_back()
-	{
-		std::destroy_at(&(*this)[_size - 1]);
-		--_size;
-	}
-	
-	constexpr size_t size() const
-	{
-		return _size;
-	}
-
-	constexpr size_t capacity() const
-	{
-		return _capacity;
-	}
-
-	template <class V>
-	void erase(iter_templ<V> first, iter_templ<V> last)
-	{
-		size_t n = last - first;
-		if (n == size()) {
-			clear();
-			return;
-		}
-		if (end() - last <= ptrdiff_t(size() / 2))
-		{
-			while (first + n < end())
-			{
-				*first = std::move(*(first + n));
-				++first;
-			}
-			while (n > 0)
-			{
-				pop_back();
-				--n;
-			}
-		}
-		else
-		{
-			if (first != begin())
-			{
-				do
-				{
-					--first;
-					*(first + n) = std::move(*first);
-				} while (first != begin());
-			}
-			while (n > 0)
-			{
-				pop_front();
-				--n;
-			}
-		}
-	}
-
-	template <class V>
-	void erase(iter_templ<V> pos)
-	{
-		erase(pos, pos + 1);
-	}
-
-
-	template <class V, class Iter>
-	iterator insert(iter_templ<V> where, Iter first, Iter last)
-	{
-		if (first == last)
-			return where;
-		size_t n = std::distance(first, last);
-		if (n + size() > capacity())
-		{
-			vector_queue<T> tmp;
-			tmp.reserve(std::max(n + size(), next_capacity()));
-			tmp.start = where - begin();
-			auto first_inserted = tmp.start;
-
-			// insert the new range first in case of an exception
-			for (auto it = first; it != last; ++it)
-			{
-				std::construct_at(&tmp.array[tmp.start + tmp._size], *it);
-				++tmp._size;
-			}
-
-			// move the last part from the current vector_queue
-			for (auto it = where; it != end(); ++it)
-			{
-				std::construct_at(&tmp.array[tmp.start + tmp._size], std::move(*it));
-				++tmp._size;
-			}
-
-			for (auto it = std::reverse_iterator<iterator>(where); it != rend(); ++it)
-			{
-				std::construct_at(&tmp.array[tmp.start - 1], std::move(*it));
-				--tmp.start;
-				++tmp._size;
-			}
-
-			swap(tmp);
-			return { first_inserted, *this };
-		}
-		if (size_t(where - begin()) < size() / 2)
-		{
-			if (where == begin())
-			{
-				insert_n_front(n, first);
-				return begin();
-			}
-
-			// insert n empty values
-			for (size_t i = 0; i < n; ++i)
-			{
-				emplace_front_no_grow();
-			}
-			for (auto it = begin() + n; it != where + n; ++it)
-			{
-				*(it - n) = std::move(*it);
-			}
-
-			iterator insert_place = { size_t(where - begin()), *this };
-
-			for (size_t i = 0; i < n; ++i)
-			{
-				*(insert_place + i) = *first;
-				++first;
-			}
-			return insert_place;
-		}
-		else
-		{
-			if (where == end())
-			{
-				std::for_each(first, last, [this](auto& value)
-					{
-						emplace_back_no_grow(value);
-					});
-				return end() - n;
-			}
-
-			// insert n empty values
-			for (size_t i = 0; i < n; ++i)
-			{
-				emplace_back_no_grow();
-			}
-			for (auto it = where; it != end() - n; ++it)
-			{
-				*(it + n) = std::move(*it);
-			}
-
-			iterator insert_place = { size_t(where - begin()), *this };
-
-			for (size_t i = 0; i < n; ++i)
-			{
-				*(insert_place + i) = *first;
-				++first;
-			}
-			return insert_place;
-		}
-	}
-
-	template <class V, class... Args, class = std::enable_if_t<std::is_constructible_v<T, Args...>>>
-	iterator emplace(iter_templ<V> where, Args&&... args)
-	{
-		if (size() == capacity())
-		{
-			vector_queue<T> tmp;
-			tmp.reserve(std::max(initial_capacity, next_capacity()));
-			tmp.start = where - begin();
-			auto first_inserted = tmp.start;
-
-			// construct the value first in case of an exception
-			std::construct_at(&tmp.array[tmp.start + tmp._size], std::forward<Args>(args)...);
-			++tmp._size;
-
-			// move the last part from the current vector_queue
-			for (auto it = where; it != end(); ++it)
-			{
-				std::construct_at(&tmp.array[tmp.start + tmp._size], std::move(*it));
-				++tmp._size;
-			}
-
-			for (auto it = std::reverse_iterator<iterator>(where); it != rend(); ++it)
-			{
-				std::construct_at(&tmp.array[tmp.start - 1], std::move(*it));
-				--tmp.start;
-				++tmp._size;
-			}
-
-			swap(tmp);
-			return { first_inserted, *this };
-		}
-		if (where == begin())
-		{
-			emplace_front_no_grow(std::forward<Args>(args)...);
-			return begin();
-		}
-		if (where == end())
-		{
-			emplace_back_no_grow(std::forward<Args>(args)...);
-			return --end();
-		}
-		if (size_t(where - begin()) < size() / 2)
-		{
-			emplace_front_no_grow(std::move(front()));
-			// the where iterator now points to the place we want to put the new value
-			for (auto it = ++begin(); true; ++it)
-			{
-				if (it == where)
-				{
-					*where = T{ std::forward<Args>(args)... };
-					return it;
-				}
-				*it = std::move(*(it + 1));
-			}
-		}
-		else
-		{
-			emplace_back_no_grow(std::move(back()));
-			// the where iterator is unchanged
-			for (auto it = end() - 2; true; --it)
-			{
-				if (it == where)
-				{
-					*where = T{ std::forward<Args>(args)... };
-					return it;
-				}
-				*it = std::move(*(it - 1));
-			}
-		}
-	}
-
-	template <class V>
-	iterator insert(iter_templ<V> where, const T& value)
-	{
-		return emplace(where, value);
-	}
-
-	template <class V>
-	iterator insert(iter_templ<V> where, T&& value)
-	{
-		return emplace(where, std::move(value));
-	}
-
-	void swap(vector_queue<T, Alloc>& other) noexcept(std::allocator_traits<Alloc>::propagate_on_container_swap::value
-		|| std::allocator_traits<Alloc>::is_always_equal::value)
-	{
-		std::swap(array, other.array);
-		std::swap(start, other.start);
-		std::swap(_capacity, other._capacity);
-		std::swap(_size, other._size);
-		std::swap(alloc, other.alloc);
-	}
-
-	template <class V>
-	struct iter_templ
-	{
-		typedef ptrdiff_t difference_type;
-		typedef T value_type;
-		typedef V* pointer;
-		typedef V& reference;
-		typedef std::random_access_iterator_tag iterator_category;
-		using container_type = std::conditional_t<std::is_const_v<V>, const vector_queue<T>, vector_queue<T>>;
-
-		V& operator*() { return (*container)[index]; }
-		V* operator->() { return &(*container)[index]; }
-
-		iter_templ<V>& operator++()
-		{
-			++index;
-			return *this;
-		}
-
-		iter_templ<V> operator++(int)
-		{
-			return { index++, *container };
-		}
-
-		iter_templ<V>& operator--()
-		{
-			--index;
-			return *this;
-		}
-
-		iter_templ<V> operator--(int)
-		{
-			return { index--, *container };
-		}
-
-		bool operator!=(const iter_templ<V>& other) const
-		{
-			return index != other.index;
-		}
-
-		bool operator==(const iter_templ<V>& other) const = default;
-
-		ptrdiff_t operator-(const iter_templ<V>& other) const
-		{
-			return ptrdiff_t(index - other.index);
-		}
-
-		iter_templ<V>& operator+=(ptrdiff_t diff)
-		{
-			index += diff;
-			return *this;
-		}
-
-		iter_templ<V>& operator-=(ptrdiff_t diff)
-		{
-			index -= diff;
-			return *this;
-		}
-
-		iter_templ<V> operator+(ptrdiff_t diff) const
-		{
-			auto tmp = *this;
-			return tmp += diff;
-		}
-
-		iter_templ<V> operator-(ptrdiff_t diff) const
-		{
-			auto tmp = *this;
-			return tmp -= diff;
-		}
-
-		std::strong_ordering operator<=>(const iter_templ& other) const
-		{
-			return index <=> other.index;
-		}
-
-		//template <class = std::enable_if_t<!std::is_const_v<V>>>
-		operator iter_templ<const T>() const
-		{
-			return { index, *container };
-		}
-
-
-		iter_templ(size_t index, container_type& container) : index(index), container(&container) {}
-	private:
-		size_t index;
-		container_type* container;
-	};
-
-private:
-	static constexpr size_t round_up(size_t number)
-	{
-		//round up to nearest power of two
-		constexpr auto bits = sizeof(size_t) * CHAR_BIT;
-		size_t power = bits - std::countl_zero(number) - 1;
-		if ((1ULL << power) != number)
-			return 1ULL << (power + 1);
-		else
-			return number;
-	}
-
-	static constexpr size_t smallest_alloc = sizeof(int) * 4; // no point in allocating tiny areas
-	static constexpr size_t initial_capacity = round_up(std::max(size_t(4), smallest_alloc / sizeof(T)));
-	T* array;
-	size_t _size;
-	size_t _capacity;
-	size_t start;
-	[[no_unique_address]] Alloc alloc;
-	
-	
-	void realloc(size_t new_capacity)
-	{
-		auto tmp = vector_queue<T, Alloc>{};
-		tmp.array = this->alloc.allocate(new_capacity);
-		tmp._capacity = new_capacity;
-		for_each_index([this, &tmp](size_t ix)
-			{
-				std::construct_at(&tmp.array[tmp._size++], std::move(array[ix]));
-				std::destroy_at(&array[ix]);
-			});
-		alloc.deallocate(array, capacity());
-		swap(tmp);
-	}
-
-	template <class Func>
-	void for_each_index(Func&& f)
-	{
-		if (start + size() > capacity()) {// wrapping
-			for (size_t i = start; i < capacity(); ++i)
-				f(i);
-			auto end = start + size() - capacity();
-			for (size_t i = 0; i < end; ++i)
-				f(i);
-		}
-		else
-		{
-			auto end = start + size();
-			for (size_t i = start; i < end; ++i)
-				f(i);
-		}
-	}
-
-	size_t next_capacity() const
-	{
-		if (_capacity == 0)
-			return initial_capacity;
-		auto new_capacity = _capacity << 1;
-		// round up to nearest smallest_alloc bytes
-		if constexpr (smallest_alloc / sizeof(T) > 1) {
-			new_capacity = new_capacity + (smallest_alloc-1) / sizeof(T);
-			new_capacity = new_capacity & ~(smallest_alloc / sizeof(T) - 1);
-		}
-		return new_capacity;
-	}
-
-	void grow()
-	{
-		if (capacity() == 0)
-		{
-			array = alloc.allocate(initial_capacity);
-			_capacity = initial_capacity;
-		}
-		else
-		{
-			realloc(round_up(next_capacity()));
-		}
-	}
-
-	template <class... Args>
-	void emplace_front_no_grow(Args&&... args)
-	{
-		std::construct_at(&array[wrap_down(1)], std::forward<Args>(args)...);
-		start = (start - 1) & (capacity() - 1);
-		++_size;
-	}
-
-
-	template <class... Args>
-	void emplace_back_no_grow(Args&&... args)
-	{
-		std::construct_at(&array[wrap_up(_size)], std::forward<Args>(args)...);
-		++_size;
-	}
-
-	template <class Iter>
-	void insert_n_front(size_t n, Iter first)
-	{
-		for (size_t i = 0; i < n; ++i)
-		{
-#ifndef VECTOR_QUEUE_NO_EXCEPTIONS
-			try {
-#endif
-				size_t index = wrap_down(n - i);
-				std::construct_at(&array[index], *first);
-				++first;
-#ifndef VECTOR_QUEUE_NO_EXCEPTIONS
-			}
-			catch (...)
-			{
-				for (size_t j = 0; j < i; ++j)
-				{
-					size_t index;
-					if (start + j < i)
-						index = start + capacity() - i + j;
-					else
-						index = start - i + 1;
-					std::destroy_at(&array[index]);
-				}
-				throw;
-			}
-#endif
-		}
-		_size += n;
-		if (start < n)
-			start = capacity() - start - n;
-		else
-			start -= n;
-	}
-#ifdef VECTOR_QUEUE_HAS_SSE
-	int find_value_sse(size_t aligned, int8_t value)
-	{
-		auto data = _mm_loadu_si128((__m128i*) & array[aligned]);
-		auto val_x = _mm_setr_epi8(value, value, value, value, value, value, value, value, value, value, value, value, value, value, value, value);
-		auto eq = _mm_cmpeq_epi8(val_x, data);
-		return _mm_movemask_epi8(eq);
-	}
-
-	int find_value_sse(size_t aligned, int16_t value)
-	{
-		auto data = _mm_loadu_si128((__m128i*) & array[aligned]);
-		auto val_x = _mm_setr_epi16(value, value, value, value, value, value, value, value);
-		auto eq = _mm_cmpeq_epi16(val_x, data);
-		return _mm_movemask_epi8(eq);
-	}
-
-	int find_value_sse(size_t aligned, int32_t value)
-	{
-		auto data = _mm_loadu_si128((__m128i*) & array[aligned]);
-		auto val_x = _mm_setr_epi32(value, value, value, value);
-		auto eq = _mm_cmpeq_epi32(val_x, data);
-		return _mm_movemask_epi8(eq);
-	}
-#endif
-
-};
-
+#pragma once
+/*
+Copyright (c) 2021 Christian Olsson
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#include <type_traits>
+#include <memory>
+#include <memory_resource>
+#include <iterator>
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <cstdlib>
+#include <limits>
+#include <stdexcept>
+#include <span>
+#include <vector>
+
+namespace vq::detail
+{
+	// integer sums wrap around instead of overflowing, for the kernels and the scalar loops alike
+	template <class T>
+	T wrapping_add(const T& a, const T& b)
+	{
+		if constexpr (std::is_integral_v<T> && !std::is_same_v<T, bool>)
+			return T(std::make_unsigned_t<T>(a) + std::make_unsigned_t<T>(b));
+		else
+			return a + b;
+	}
+}
+
+// SIMD kernels are used on x86-64, or on 32 bit x86 when VECTOR_QUEUE_HAS_SSE says SSE2 is available.
+// The instruction set is picked at runtime, define VECTOR_QUEUE_NO_SIMD to always use the scalar code.
+#if !defined(VECTOR_QUEUE_NO_SIMD) && (defined(__x86_64__) || defined(_M_X64) || defined(VECTOR_QUEUE_HAS_SSE))
+#define VECTOR_QUEUE_SIMD
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define VECTOR_QUEUE_TARGET(isa)
+#else
+#define VECTOR_QUEUE_TARGET(isa) __attribute__((target(isa)))
+#endif
+
+namespace vq::simd
+{
+	enum class level { sse2, avx2, avx512 };
+
+	inline level detect_level()
+	{
+#if defined(_MSC_VER) && !defined(__clang__)
+		int regs[4];
+		__cpuid(regs, 0);
+		if (regs[0] < 7)
+			return level::sse2;
+		__cpuid(regs, 1);
+		bool osxsave = regs[2] & (1 << 27);
+		if (!osxsave)
+			return level::sse2;
+		auto xcr0 = _xgetbv(0);
+		__cpuidex(regs, 7, 0);
+		bool avx2 = (regs[1] & (1 << 5)) && (xcr0 & 0x6) == 0x6;
+		bool avx512 = (regs[1] & (1 << 16)) && (regs[1] & (1 << 30)) && (xcr0 & 0xe6) == 0xe6;
+#else
+		__builtin_cpu_init();
+		bool avx2 = __builtin_cpu_supports("avx2");
+		bool avx512 = __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw");
+#endif
+		if (avx512)
+			return level::avx512;
+		if (avx2)
+			return level::avx2;
+		return level::sse2;
+	}
+
+	inline level& active_level()
+	{
+		static level current = detect_level();
+		return current;
+	}
+
+	// the instruction set the kernels use, detected once per process
+	inline level current_level()
+	{
+		return active_level();
+	}
+
+	// use at most the given instruction set, for testing and benchmarking
+	inline void limit_level(level max)
+	{
+		active_level() = std::min(max, detect_level());
+	}
+
+	template <class T, size_t Size = sizeof(T)>
+	struct lane
+	{
+		using type = void;
+	};
+
+	template <class T> struct lane<T, 1> { using type = uint8_t; };
+	template <class T> struct lane<T, 2> { using type = uint16_t; };
+	template <class T> struct lane<T, 4> { using type = uint32_t; };
+	template <class T> struct lane<T, 8> { using type = uint64_t; };
+
+	// the type the kernels compare T as, or void if T has no kernels.
+	// Integers, enums and pointers are compared bitwise as unsigned integers of the same size,
+	// floating point values are compared as themselves so NaN and signed zero behave as with ==
+	template <class T>
+	using lane_t = std::conditional_t<std::is_same_v<T, float> || std::is_same_v<T, double>, T,
+		std::conditional_t<std::is_integral_v<T> || std::is_enum_v<T> || std::is_pointer_v<T>, typename lane<T>::type, void>>;
+
+	template <class T>
+	constexpr bool has_kernels = !std::is_void_v<lane_t<T>>;
+
+	// the most values find_any_of compares in the kernels
+	constexpr size_t max_any_of = 8;
+
+	template <class T>
+	constexpr bool has_sum_kernel = std::is_same_v<T, float> || std::is_same_v<T, double>
+		|| (std::is_integral_v<T> && !std::is_same_v<T, bool> && (sizeof(T) == 4 || sizeof(T) == 8));
+
+	template <class T>
+	constexpr bool has_minmax_kernel = std::is_same_v<T, float> || std::is_same_v<T, double>
+		|| (std::is_integral_v<T> && !std::is_same_v<T, bool> && sizeof(T) == 4);
+
+	namespace sse2
+	{
+		template <class U> struct vector { using type = __m128i; };
+		template <> struct vector<float> { using type = __m128; };
+		template <> struct vector<double> { using type = __m128d; };
+
+		template <class U>
+		struct ops
+		{
+			using vec = typename vector<U>::type;
+			using mask = uint32_t;
+			static constexpr size_t lanes = 16 / sizeof(U);
+			static constexpr int mask_bits = sizeof(U); // bits per lane in a mask
+
+			static vec load(const void* p)
+			{
+				if constexpr (std::is_same_v<U, float>)
+					return _mm_loadu_ps(static_cast<const float*>(p));
+				else if constexpr (std::is_same_v<U, double>)
+					return _mm_loadu_pd(static_cast<const double*>(p));
+				else
+					return _mm_loadu_si128(static_cast<const __m128i*>(p));
+			}
+
+			static vec splat(U value)
+			{
+				if constexpr (std::is_same_v<U, float>)
+					return _mm_set1_ps(value);
+				else if constexpr (std::is_same_v<U, double>)
+					return _mm_set1_pd(value);
+				else if constexpr (sizeof(U) == 1)
+					return _mm_set1_epi8(char(value));
+				else if constexpr (sizeof(U) == 2)
+					return _mm_set1_epi16(short(value));
+				else if constexpr (sizeof(U) == 4)
+					return _mm_set1_epi32(int(value));
+				else
+					return _mm_set1_epi64x((long long)value);
+			}
+
+			static mask eq(vec a, vec b)
+			{
+				if constexpr (std::is_same_v<U, float>)
+					return mask(_mm_movemask_epi8(_mm_castps_si128(_mm_cmpeq_ps(a, b))));
+				else if constexpr (std::is_same_v<U, double>)
+					return mask(_mm_movemask_epi8(_mm_castpd_si128(_mm_cmpeq_pd(a, b))));
+				else if constexpr (sizeof(U) == 1)
+					return mask(_mm_movemask_epi8(_mm_cmpeq_epi8(a, b)));
+				else if constexpr (sizeof(U) == 2)
+					return mask(_mm_movemask_epi8(_mm_cmpeq_epi16(a, b)));
+				else if constexpr (sizeof(U) == 4)
+					return mask(_mm_movemask_epi8(_mm_cmpeq_epi32(a, b)));
+				else
+				{
+					// no 64 bit compare in SSE2, both 32 bit halves have to be equal
+					auto halves = _mm_cmpeq_epi32(a, b);
+					auto swapped = _mm_shuffle_epi32(halves, _MM_SHUFFLE(2, 3, 0, 1));
+					return mask(_mm_movemask_epi8(_mm_and_si128(halves, swapped)));
+				}
+			}
+		};
+
+		// arithmetic on vectors of T for the reductions
+		template <class T>
+		struct arith
+		{
+			using o = ops<lane_t<T>>;
+			using vec = typename o::vec;
+			static constexpr size_t lanes = o::lanes;
+
+			static vec load(const T* p)
+			{
+				return o::load(p);
+			}
+
+			static vec splat(T value)
+			{
+				return o::splat(std::bit_cast<lane_t<T>>(value));
+			}
+
+			static void store(T* p, vec v)
+			{
+				if constexpr (std::is_same_v<T, float>)
+					_mm_storeu_ps(p, v);
+				else if constexpr (std::is_same_v<T, double>)
+					_mm_storeu_pd(p, v);
+				else
+					_mm_storeu_si128(reinterpret_cast<__m128i*>(p), v);
+			}
+
+			static vec add(vec a, vec b)
+			{
+				if constexpr (std::is_same_v<T, float>)
+					return _mm_add_ps(a, b);
+				else if constexpr (std::is_same_v<T, double>)
+					return _mm_add_pd(a, b);
+				else if constexpr (sizeof(T) == 4)
+					return _mm_add_epi32(a, b);
+				else
+					return _mm_add_epi64(a, b);
+			}
+
+			static vec min_max(vec a, vec b, bool want_max)
+			{
+				if constexpr (std::is_same_v<T, float>)
+					return want_max ? _mm_max_ps(a, b) : _mm_min_ps(a, b);
+				else if constexpr (std::is_same_v<T, double>)
+					return want_max ? _mm_max_pd(a, b) : _mm_min_pd(a, b);
+				else if constexpr (std::is_signed_v<T>)
+					return select(_mm_cmpgt_epi32(a, b), a, b, want_max);
+				else
+				{
+					auto bias = _mm_set1_epi32(int(0x80000000u));
+					return select(_mm_cmpgt_epi32(_mm_xor_si128(a, bias), _mm_xor_si128(b, bias)), a, b, want_max);
+				}
+			}
+
+			// no 32 bit integer min and max in SSE2, pick from a and b with the a > b mask
+			static vec select(vec greater, vec a, vec b, bool want_max)
+			{
+				if (want_max)
+					return _mm_or_si128(_mm_and_si128(greater, a), _mm_andnot_si128(greater, b));
+				return _mm_or_si128(_mm_and_si128(greater, b), _mm_andnot_si128(greater, a));
+			}
+		};
+	}
+
+	namespace avx2
+	{
+		template <class U> struct vector { using type = __m256i; };
+		template <> struct vector<float> { using type = __m256; };
+		template <> struct vector<double> { using type = __m256d; };
+
+		template <class U>
+		struct ops
+		{
+			using vec = typename vector<U>::type;
+			using mask = uint32_t;
+			static constexpr size_t lanes = 32 / sizeof(U);
+			static constexpr int mask_bits = sizeof(U);
+
+			VECTOR_QUEUE_TARGET("avx2") static vec load(const void* p)
+			{
+				if constexpr (std::is_same_v<U, float>)
+					return _mm256_loadu_ps(static_cast<const float*>(p));
+				else if constexpr (std::is_same_v<U, double>)
+					return _mm256_loadu_pd(static_cast<const double*>(p));
+				else
+					return _mm256_loadu_si256(static_cast<const __m256i*>(p));
+			}
+
+			VECTOR_QUEUE_TARGET("avx2") static vec splat(U value)
+			{
+				if constexpr (std::is_same_v<U, float>)
+					return _mm256_set1_ps(value);
+				else if constexpr (std::is_same_v<U, double>)
+					return _mm256_set1_pd(value);
+				else if constexpr (sizeof(U) == 1)
+					return _mm256_set1_epi8(char(value));
+				else if constexpr (sizeof(U) == 2)
+					return _mm256_set1_epi16(short(value));
+				else if constexpr (sizeof(U) == 4)
+					return _mm256_set1_epi32(int(value));
+				else
+					return _mm256_set1_epi64x((long long)value);
+			}
+
+			VECTOR_QUEUE_TARGET("avx2") static mask eq(vec a, vec b)
+			{
+				if constexpr (std::is_same_v<U, float>)
+					return mask(_mm256_movemask_epi8(_mm256_castps_si256(_mm256_cmp_ps(a, b, _CMP_EQ_OQ))));
+				else if constexpr (std::is_same_v<U, double>)
+					return mask(_mm256_movemask_epi8(_mm256_castpd_si256(_mm256_cmp_pd(a, b, _CMP_EQ_OQ))));
+				else if constexpr (sizeof(U) == 1)
+					return mask(_mm256_movemask_epi8(_mm256_cmpeq_epi8(a, b)));
+				else if constexpr (sizeof(U) == 2)
+					return mask(_mm256_movemask_epi8(_mm256_cmpeq_epi16(a, b)));
+				else if constexpr (sizeof(U) == 4)
+					return mask(_mm256_movemask_epi8(_mm256_cmpeq_epi32(a, b)));
+				else
+					return mask(_mm256_movemask_epi8(_mm256_cmpeq_epi64(a, b)));
+			}
+		};
+
+		// arithmetic on vectors of T for the reductions
+		template <class T>
+		struct arith
+		{
+			using o = ops<lane_t<T>>;
+			using vec = typename o::vec;
+			static constexpr size_t lanes = o::lanes;
+
+			VECTOR_QUEUE_TARGET("avx2") static vec load(const T* p)
+			{
+				return o::load(p);
+			}
+
+			VECTOR_QUEUE_TARGET("avx2") static vec splat(T value)
+			{
+				return o::splat(std::bit_cast<lane_t<T>>(value));
+			}
+
+			VECTOR_QUEUE_TARGET("avx2") static void store(T* p, vec v)
+			{
+				if constexpr (std::is_same_v<T, float>)
+					_mm256_storeu_ps(p, v);
+				else if constexpr (std::is_same_v<T, double>)
+					_mm256_storeu_pd(p, v);
+				else
+					_mm256_storeu_si256(reinterpret_cast<__m256i*>(p), v);
+			}
+
+			VECTOR_QUEUE_TARGET("avx2") static vec add(vec a, vec b)
+			{
+				if constexpr (std::is_same_v<T, float>)
+					return _mm256_add_ps(a, b);
+				else if constexpr (std::is_same_v<T, double>)
+					return _mm256_add_pd(a, b);
+				else if constexpr (sizeof(T) == 4)
+					return _mm256_add_epi32(a, b);
+				else
+					return _mm256_add_epi64(a, b);
+			}
+
+			VECTOR_QUEUE_TARGET("avx2") static vec min_max(vec a, vec b, bool want_max)
+			{
+				if constexpr (std::is_same_v<T, float>)
+					return want_max ? _mm256_max_ps(a, b) : _mm256_min_ps(a, b);
+				else if constexpr (std::is_same_v<T, double>)
+					return want_max ? _mm256_max_pd(a, b) : _mm256_min_pd(a, b);
+				else if constexpr (std::is_signed_v<T>)
+					return want_max ? _mm256_max_epi32(a, b) : _mm256_min_epi32(a, b);
+				else
+					return want_max ? _mm256_max_epu32(a, b) : _mm256_min_epu32(a, b);
+			}
+		};
+	}
+
+	namespace avx512
+	{
+		template <class U> struct vector { using type = __m512i; };
+		template <> struct vector<float> { using type = __m512; };
+		template <> struct vector<double> { using type = __m512d; };
+
+		template <class U>
+		struct ops
+		{
+			using vec = typename vector<U>::type;
+			using mask = uint64_t;
+			static constexpr size_t lanes = 64 / sizeof(U);
+			static constexpr int mask_bits = 1;
+
+			VECTOR_QUEUE_TARGET("avx512f,avx512bw") static vec load(const void* p)
+			{
+				if constexpr (std::is_same_v<U, float>)
+					return _mm512_loadu_ps(p);
+				else if constexpr (std::is_same_v<U, double>)
+					return _mm512_loadu_pd(p);
+				else
+					return _mm512_loadu_si512(p);
+			}
+
+			VECTOR_QUEUE_TARGET("avx512f,avx512bw") static vec splat(U value)
+			{
+				if constexpr (std::is_same_v<U, float>)
+					return _mm512_set1_ps(value);
+				else if constexpr (std::is_same_v<U, double>)
+					return _mm512_set1_pd(value);
+				else if constexpr (sizeof(U) == 1)
+					return _mm512_set1_epi8(char(value));
+				else if constexpr (sizeof(U) == 2)
+					return _mm512_set1_epi16(short(value));
+				else if constexpr (sizeof(U) == 4)
+					return _mm512_set1_epi32(int(value));
+				else
+					return _mm512_set1_epi64((long long)value);
+			}
+
+			VECTOR_QUEUE_TARGET("avx512f,avx512bw") static mask eq(vec a, vec b)
+			{
+				if constexpr (std::is_same_v<U, float>)
+					return _mm512_cmp_ps_mask(a, b, _CMP_EQ_OQ);
+				else if constexpr (std::is_same_v<U, double>)
+					return _mm512_cmp_pd_mask(a, b, _CMP_EQ_OQ);
+				else if constexpr (sizeof(U) == 1)
+					return _mm512_cmpeq_epi8_mask(a, b);
+				else if constexpr (sizeof(U) == 2)
+					return _mm512_cmpeq_epi16_mask(a, b);
+				else if constexpr (sizeof(U) == 4)
+					return _mm512_cmpeq_epi32_mask(a, b);
+				else
+					return _mm512_cmpeq_epi64_mask(a, b);
+			}
+		};
+
+		// arithmetic on vectors of T for the reductions
+		template <class T>
+		struct arith
+		{
+			using o = ops<lane_t<T>>;
+			using vec = typename o::vec;
+			static constexpr size_t lanes = o::lanes;
+
+			VECTOR_QUEUE_TARGET("avx512f,avx512bw") static vec load(const T* p)
+			{
+				return o::load(p);
+			}
+
+			VECTOR_QUEUE_TARGET("avx512f,avx512bw") static vec splat(T value)
+			{
+				return o::splat(std::bit_cast<lane_t<T>>(value));
+			}
+
+			VECTOR_QUEUE_TARGET("avx512f,avx512bw") static void store(T* p, vec v)
+			{
+				if constexpr (std::is_same_v<T, float>)
+					_mm512_storeu_ps(p, v);
+				else if constexpr (std::is_same_v<T, double>)
+					_mm512_storeu_pd(p, v);
+				else
+					_mm512_storeu_si512(p, v);
+			}
+
+			VECTOR_QUEUE_TARGET("avx512f,avx512bw") static vec add(vec a, vec b)
+			{
+				if constexpr (std::is_same_v<T, float>)
+					return _mm512_add_ps(a, b);
+				else if constexpr (std::is_same_v<T, double>)
+					return _mm512_add_pd(a, b);
+				else if constexpr (sizeof(T) == 4)
+					return _mm512_add_epi32(a, b);
+				else
+					return _mm512_add_epi64(a, b);
+			}
+
+			VECTOR_QUEUE_TARGET("avx512f,avx512bw") static vec min_max(vec a, vec b, bool want_max)
+			{
+				// the masked forms, the plain ones trip -Wmaybe-uninitialized in some GCC versions
+				constexpr auto all = static_cast<std::conditional_t<lanes == 8, __mmask8, __mmask16>>(-1);
+				if constexpr (std::is_same_v<T, float>)
+					return want_max ? _mm512_mask_max_ps(a, all, a, b) : _mm512_mask_min_ps(a, all, a, b);
+				else if constexpr (std::is_same_v<T, double>)
+					return want_max ? _mm512_mask_max_pd(a, all, a, b) : _mm512_mask_min_pd(a, all, a, b);
+				else if constexpr (std::is_signed_v<T>)
+					return want_max ? _mm512_mask_max_epi32(a, all, a, b) : _mm512_mask_min_epi32(a, all, a, b);
+				else
+					return want_max ? _mm512_mask_max_epu32(a, all, a, b) : _mm512_mask_min_epu32(a, all, a, b);
+			}
+		};
+	}
+}
+
+// the kernels are written once and compiled for every instruction set
+#define VECTOR_QUEUE_SIMD_ISA sse2
+#define VECTOR_QUEUE_SIMD_TARGET
+#include "vector_queue_kernels.h"
+#undef VECTOR_QUEUE_SIMD_ISA
+#undef VECTOR_QUEUE_SIMD_TARGET
+#define VECTOR_QUEUE_SIMD_ISA avx2
+#define VECTOR_QUEUE_SIMD_TARGET VECTOR_QUEUE_TARGET("avx2")
+#include "vector_queue_kernels.h"
+#undef VECTOR_QUEUE_SIMD_ISA
+#undef VECTOR_QUEUE_SIMD_TARGET
+#define VECTOR_QUEUE_SIMD_ISA avx512
+#define VECTOR_QUEUE_SIMD_TARGET VECTOR_QUEUE_TARGET("avx512f,avx512bw")
+#include "vector_queue_kernels.h"
+#undef VECTOR_QUEUE_SIMD_ISA
+#undef VECTOR_QUEUE_SIMD_TARGET
+
+namespace vq::simd
+{
+	template <class Fn>
+	Fn pick(Fn sse2, Fn avx2, Fn avx512)
+	{
+		switch (current_level())
+		{
+		case level::avx512:
+			return avx512;
+		case level::avx2:
+			return avx2;
+		default:
+			return sse2;
+		}
+	}
+
+	template <class T>
+	using find_fn = const T* (*)(const T*, const T*, T);
+
+	template <class T>
+	find_fn<T> find_kernel()
+	{
+		return pick<find_fn<T>>(&sse2::find<T>, &avx2::find<T>, &avx512::find<T>);
+	}
+
+	template <class T>
+	find_fn<T> rfind_kernel()
+	{
+		return pick<find_fn<T>>(&sse2::rfind<T>, &avx2::rfind<T>, &avx512::rfind<T>);
+	}
+
+	template <class T>
+	using count_fn = size_t (*)(const T*, const T*, T);
+
+	template <class T>
+	count_fn<T> count_kernel()
+	{
+		return pick<count_fn<T>>(&sse2::count<T>, &avx2::count<T>, &avx512::count<T>);
+	}
+
+	template <class T>
+	using sum_fn = T (*)(const T*, const T*);
+
+	template <class T>
+	sum_fn<T> sum_kernel()
+	{
+		return pick<sum_fn<T>>(&sse2::sum<T>, &avx2::sum<T>, &avx512::sum<T>);
+	}
+
+	template <class T>
+	using minmax_fn = void (*)(const T*, const T*, T&, T&);
+
+	template <class T>
+	minmax_fn<T> minmax_kernel()
+	{
+		return pick<minmax_fn<T>>(&sse2::minmax<T>, &avx2::minmax<T>, &avx512::minmax<T>);
+	}
+
+	template <class T>
+	using find_any_of_fn = const T* (*)(const T*, const T*, const T*, size_t);
+
+	template <class T>
+	find_any_of_fn<T> find_any_of_kernel()
+	{
+		return pick<find_any_of_fn<T>>(&sse2::find_any_of<T>, &avx2::find_any_of<T>, &avx512::find_any_of<T>);
+	}
+}
+#endif
+
+template <class CharT, class Traits, class Alloc> class basic_vector_queue_streambuf;
+template <class Alloc> class record_queue;
+template <class Alloc> class task_queue;
+
+namespace vq
+{
+	// Growth policies pick the capacities of a vector_queue. next_capacity(capacity, element_size) is the
+	// capacity a full queue grows to, also from 0, and fit_capacity(n, element_size) is what reserve(n)
+	// allocates, at least n. If power_of_two is true every capacity is a power of two and indexes wrap
+	// with a mask, otherwise they wrap with a compare and subtract. The policy is stored in the queue.
+
+	// the smallest capacity worth allocating
+	constexpr size_t initial_capacity(size_t element_size)
+	{
+		return std::bit_ceil(std::max(size_t(4), 16 / element_size));
+	}
+
+	// doubles the capacity, the default
+	struct double_growth
+	{
+		static constexpr bool power_of_two = true;
+
+		size_t next_capacity(size_t capacity, size_t element_size) const
+		{
+			return capacity == 0 ? initial_capacity(element_size) : capacity * 2;
+		}
+
+		size_t fit_capacity(size_t n, size_t) const
+		{
+			return std::bit_ceil(n);
+		}
+	};
+
+	// keeps the capacity reserve() asks for and doubles it when full, without rounding to a power of two
+	struct exact_growth
+	{
+		static constexpr bool power_of_two = false;
+
+		size_t next_capacity(size_t capacity, size_t element_size) const
+		{
+			return capacity == 0 ? initial_capacity(element_size) : capacity * 2;
+		}
+
+		size_t fit_capacity(size_t n, size_t) const
+		{
+			return n;
+		}
+	};
+
+	// grows by half, at most a third of the memory is unused after growing instead of half
+	struct half_growth
+	{
+		static constexpr bool power_of_two = false;
+
+		size_t next_capacity(size_t capacity, size_t element_size) const
+		{
+			return capacity == 0 ? initial_capacity(element_size) : capacity + std::max<size_t>(1, capacity / 2);
+		}
+
+		size_t fit_capacity(size_t n, size_t) const
+		{
+			return n;
+		}
+	};
+
+	// grows by half rounded up to whole pages, so the buffer ends where the last page the allocator maps does
+	template <size_t PageSize = 4096>
+	struct page_growth
+	{
+		static constexpr bool power_of_two = false;
+
+		size_t next_capacity(size_t capacity, size_t element_size) const
+		{
+			return fit_capacity(capacity + std::max<size_t>(1, capacity / 2), element_size);
+		}
+
+		size_t fit_capacity(size_t n, size_t element_size) const
+		{
+			size_t pages = (n * element_size + PageSize - 1) / PageSize;
+			return pages * PageSize / element_size;
+		}
+	};
+
+	// grows by Increment elements at a time
+	template <size_t Increment>
+	struct fixed_growth
+	{
+		static_assert(Increment > 0);
+		static constexpr bool power_of_two = false;
+
+		size_t next_capacity(size_t capacity, size_t) const
+		{
+			return capacity + Increment;
+		}
+
+		size_t fit_capacity(size_t n, size_t) const
+		{
+			return n;
+		}
+	};
+
+	// Grows like Growth and halves the capacity once the size has stayed below a quarter of it for Pops
+	// pops in a row, so a queue gives back the memory of a burst without thrashing around one size.
+	// A pop that shrinks moves the elements like a push that grows does.
+	template <class Growth = double_growth, size_t Pops = 64>
+	struct shrink_after_bursts : Growth
+	{
+		size_t shrink_capacity(size_t size, size_t capacity, size_t element_size)
+		{
+			if (size >= capacity / 4 || capacity / 2 < initial_capacity(element_size))
+			{
+				low_pops = 0;
+				return capacity;
+			}
+			if (++low_pops < Pops)
+				return capacity;
+			low_pops = 0;
+			return Growth::fit_capacity(capacity / 2, element_size);
+		}
+
+		size_t low_pops = 0;
+	};
+}
+
+namespace vq::detail
+{
+	// where a vector_queue keeps its start and capacity, two size_t unless it's compact
+	template <bool Compact>
+	struct ring_layout
+	{
+		static constexpr size_t max_capacity = std::numeric_limits<size_t>::max();
+
+		constexpr size_t start() const { return _start; }
+		constexpr void set_start(size_t start) { _start = start; }
+		constexpr size_t capacity() const { return _capacity; }
+		constexpr void set_capacity(size_t capacity) { _capacity = capacity; }
+
+		size_t _start = 0;
+		size_t _capacity = 0;
+	};
+
+	// a 32 bit word with the start in the low bits and the log2 of the capacity plus one above it,
+	// or zero for no buffer, so the capacity has to be a power of two
+	template <>
+	struct ring_layout<true>
+	{
+		static constexpr int start_bits = 27;
+		static constexpr uint32_t start_mask = (uint32_t(1) << start_bits) - 1;
+		static constexpr size_t max_capacity = size_t(1) << start_bits;
+
+		constexpr size_t start() const { return bits & start_mask; }
+		constexpr void set_start(size_t start) { bits = (bits & ~start_mask) | uint32_t(start); }
+		constexpr size_t capacity() const
+		{
+			uint32_t shift = bits >> start_bits;
+			return shift == 0 ? 0 : size_t(1) << (shift - 1);
+		}
+		constexpr void set_capacity(size_t capacity)
+		{
+			uint32_t shift = capacity == 0 ? 0 : uint32_t(std::countr_zero(capacity) + 1);
+			bits = (bits & start_mask) | shift << start_bits;
+		}
+
+		uint32_t bits = 0;
+	};
+}
+
+template <class T, class Alloc, class GrowthPolicy, class SizeType> struct vector_queue;
+namespace vq
+{
+	struct parallel_policy;
+	template <class T, class... Params, class Compare> void sort(const parallel_policy&, vector_queue<T, Params...>&, Compare);
+}
+
+// SizeType uint32_t makes the queue 16 bytes instead of 32 by packing the start and the log2 of the
+// capacity into one 32 bit word, the capacity is then limited to 2^27 elements
+template <class T, class Alloc = std::allocator<T>, class GrowthPolicy = vq::double_growth, class SizeType = size_t>
+struct vector_queue
+{
+	static_assert(std::is_same_v<SizeType, size_t> || std::is_same_v<SizeType, uint32_t>, "SizeType has to be size_t or uint32_t");
+	static_assert(std::is_same_v<SizeType, size_t> || GrowthPolicy::power_of_two, "a uint32_t SizeType needs a power of two growth policy");
+
+	template <class V> struct iter_templ;
+	using allocator_type = Alloc;
+	using growth_policy = GrowthPolicy;
+	using size_type = SizeType;
+	using value_type = T;
+	using reference = T&;
+	using const_reference = const T&;
+	using iterator = iter_templ<T>;
+	using const_iterator = iter_templ<const T>;
+	using reverse_iterator = std::reverse_iterator<iterator>;
+	using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+	using difference_type = ptrdiff_t;
+
+	constexpr vector_queue() noexcept(noexcept(Alloc())) : array{}, _size{}, alloc{}
+	{}
+	constexpr explicit vector_queue(const Alloc& alloc) noexcept : array{}, _size{}, alloc{ alloc }
+	{}
+	vector_queue(std::initializer_list<T> values, const Alloc& alloc = Alloc()) : array{}, _size{}, alloc(alloc)
+	{
+		allocate_for(values.size());
+		for (auto& val : values)
+		{
+			construct(&array[_size++], val);
+		}
+	}
+
+	vector_queue(vector_queue&& other) noexcept : array(other.array), _size(other._size), layout(other.layout), alloc(std::move(other.alloc)),
+		growth(other.growth)
+	{
+		other._size = 0;
+		other.array = nullptr;
+		other.layout = {};
+	}
+
+	// takes the buffer of other if the allocators are equal, otherwise moves the elements
+	vector_queue(vector_queue&& other, const Alloc& alloc) : array{}, _size{}, alloc(alloc), growth(other.growth)
+	{
+		if (alloc_traits::is_always_equal::value || this->alloc == other.alloc)
+		{
+			swap_buffers(other);
+			return;
+		}
+		allocate_for(other.size());
+		for (auto& val : other)
+		{
+			construct(&array[_size++], std::move(val));
+		}
+		other.clear();
+	}
+
+	vector_queue(const vector_queue& other) : vector_queue(other, alloc_traits::select_on_container_copy_construction(other.alloc))
+	{}
+
+	vector_queue(const vector_queue& other, const Alloc& alloc) : array{}, _size{}, alloc(alloc), growth(other.growth)
+	{
+		allocate_for(other.size());
+		for (auto& val : other)
+		{
+			construct(&array[_size++], val);
+		}
+	}
+
+	~vector_queue()
+	{
+		release();
+	}
+
+	vector_queue& operator=(vector_queue&& other) noexcept(alloc_traits::propagate_on_container_move_assignment::value
+		|| alloc_traits::is_always_equal::value)
+	{
+		if (this == &other)
+			return *this;
+		if constexpr (alloc_traits::propagate_on_container_move_assignment::value)
+		{
+			swap_buffers(other);
+			std::swap(alloc, other.alloc);
+		}
+		else if (alloc_traits::is_always_equal::value || alloc == other.alloc)
+		{
+			swap_buffers(other);
+		}
+		else
+		{
+			// the buffer of other can't be freed with our allocator
+			clear();
+			reserve(other.size());
+			for (auto& val : other)
+			{
+				construct(&array[_size++], std::move(val));
+			}
+		}
+		growth = other.growth;
+		other.clear();
+		return *this;
+	}
+
+	vector_queue& operator=(const vector_queue& other)
+	{
+		if (this == &other)
+			return *this;
+
+		if constexpr (alloc_traits::propagate_on_container_copy_assignment::value)
+		{
+			if (alloc != other.alloc)
+				release();
+			alloc = other.alloc;
+		}
+		growth = other.growth;
+		clear();
+		if (capacity() < other.size()) {
+			release();
+			array = alloc_traits::allocate(alloc, fit_capacity(other.size()));
+			set_capacity(fit_capacity(other.size()));
+		}
+		for (auto& val : other)
+		{
+			construct(&array[_size++], val);
+		}
+		return *this;
+	}
+
+	iterator find(const T& value)
+	{
+		return { find_index(value), *this };
+	}
+
+	const_iterator find(const T& value) const
+	{
+		return { find_index(value), *this };
+	}
+
+	template <class Pred>
+	iterator find_if(Pred pred)
+	{
+		return { find_if_index(pred), *this };
+	}
+
+	template <class Pred>
+	const_iterator find_if(Pred pred) const
+	{
+		return { find_if_index(pred), *this };
+	}
+
+	// find the last element equal to value, or end() if there is none
+	iterator rfind(const T& value)
+	{
+		return { rfind_index(value), *this };
+	}
+
+	const_iterator rfind(const T& value) const
+	{
+		return { rfind_index(value), *this };
+	}
+
+	template <class Pred>
+	iterator find_last_if(Pred pred)
+	{
+		return { find_last_if_index(pred), *this };
+	}
+
+	template <class Pred>
+	const_iterator find_last_if(Pred pred) const
+	{
+		return { find_last_if_index(pred), *this };
+	}
+
+	// find the first element equal to any of the values
+	iterator find_any_of(std::initializer_list<T> values)
+	{
+		return { find_any_of_index(values), *this };
+	}
+
+	const_iterator find_any_of(std::initializer_list<T> values) const
+	{
+		return { find_any_of_index(values), *this };
+	}
+
+	bool contains(const T& value) const
+	{
+		return find_index(value) != size();
+	}
+
+	size_t count(const T& value) const
+	{
+#ifdef VECTOR_QUEUE_SIMD
+		if constexpr (vq::simd::has_kernels<T>)
+		{
+			if (size() * sizeof(T) >= 32)
+			{
+				auto kernel = vq::simd::count_kernel<T>();
+				size_t first_size = first_segment_size();
+				return kernel(array + start(), array + start() + first_size, value) + kernel(array, array + size() - first_size, value);
+			}
+		}
+#endif
+		size_t n = 0;
+		size_t first_size = first_segment_size();
+		for (size_t i = start(); i < start() + first_size; ++i)
+			n += array[i] == value;
+		for (size_t i = 0; i < size() - first_size; ++i)
+			n += array[i] == value;
+		return n;
+	}
+
+	// the sum of the elements, integers wrap around on overflow and floating point values
+	// are not added in the same order as std::accumulate so the rounding can differ
+	T sum() const
+	{
+#ifdef VECTOR_QUEUE_SIMD
+		if constexpr (vq::simd::has_sum_kernel<T>)
+		{
+			if (size() * sizeof(T) >= 32)
+			{
+				auto kernel = vq::simd::sum_kernel<T>();
+				size_t first_size = first_segment_size();
+				return vq::detail::wrapping_add(kernel(array + start(), array + start() + first_size), kernel(array, array + size() - first_size));
+			}
+		}
+#endif
+		T total{};
+		size_t first_size = first_segment_size();
+		for (size_t i = start(); i < start() + first_size; ++i)
+			total = vq::detail::wrapping_add(total, array[i]);
+		for (size_t i = 0; i < size() - first_size; ++i)
+			total = vq::detail::wrapping_add(total, array[i]);
+		return total;
+	}
+
+	// the smallest and the largest element, the queue must not be empty.
+	// The result is unspecified if there are NaNs in the queue
+	std::pair<T, T> minmax() const
+	{
+		std::pair<T, T> result{ front(), front() };
+		size_t first_size = first_segment_size();
+#ifdef VECTOR_QUEUE_SIMD
+		if constexpr (vq::simd::has_minmax_kernel<T>)
+		{
+			if (size() * sizeof(T) >= 32)
+			{
+				auto kernel = vq::simd::minmax_kernel<T>();
+				kernel(array + start(), array + start() + first_size, result.first, result.second);
+				kernel(array, array + size() - first_size, result.first, result.second);
+				return result;
+			}
+		}
+#endif
+		auto update = [&result](const T& x)
+		{
+			if (x < result.first)
+				result.first = x;
+			if (result.second < x)
+				result.second = x;
+		};
+		for (size_t i = start(); i < start() + first_size; ++i)
+			update(array[i]);
+		for (size_t i = 0; i < size() - first_size; ++i)
+			update(array[i]);
+		return result;
+	}
+
+	T min() const
+	{
+		return minmax().first;
+	}
+
+	T max() const
+	{
+		return minmax().second;
+	}
+
+	iterator begin() { return { 0, *this }; }
+	iterator end() { return { _size, *this }; }
+	const_iterator begin() const { return { 0, *this }; }
+	const_iterator end() const { return { _size, *this }; }
+	const_iterator cbegin() const { return { 0, *this }; }
+	const_iterator cend() const { return { _size, *this }; }
+	reverse_iterator rbegin() { return reverse_iterator{ iterator{ _size, *this} }; }
+	reverse_iterator rend() { return reverse_iterator{ iterator{ 0, *this} }; }
+	const_reverse_iterator crbegin() const { return const_reverse_iterator{ const_iterator{ _size, *this} }; }
+	const_reverse_iterator crend() const { return const_reverse_iterator{ const_iterator{ 0, *this} }; }
+
+	constexpr bool empty() const
+	{
+		return size() == 0;
+	}
+
+	T& front()
+	{
+		return (*this)[0];
+	}
+
+	const T& front() const
+	{
+		return (*this)[0];
+	}
+
+	T& back()
+	{
+		return (*this)[size() - 1];
+	}
+
+	const T& back() const
+	{
+		return (*this)[size() - 1];
+	}
+
+	// the buffer position index elements after the front, index <= capacity()
+	constexpr size_t wrap_up(size_t index) const
+	{
+		return wrap(start() + index, capacity());
+	}
+
+	// the buffer position index elements before the front, index <= capacity()
+	constexpr size_t wrap_down(size_t index) const
+	{
+		return wrap(start() + capacity() - index, capacity());
+	}
+
+	// a position less than twice the capacity wrapped into the buffer
+	static constexpr size_t wrap(size_t position, size_t capacity)
+	{
+		if constexpr (GrowthPolicy::power_of_two)
+			return position & (capacity - 1);
+		else
+			return position >= capacity ? position - capacity : position;
+	}
+
+
+	T& operator[](size_t index)
+	{
+		return array[wrap_up(index)];
+	}
+
+	const T& operator[](size_t index) const
+	{
+		return array[wrap_up(index)];
+	}
+
+
+	template <class... Args, class = std::enable_if_t<std::is_constructible_v<T, Args...>>>
+	void emplace_back(Args&&... args)
+	{
+		if (size() == capacity()) {
+			grow_emplace(false, std::forward<Args>(args)...);
+		}
+		else
+		{
+			emplace_back_no_grow(std::forward<Args>(args)...);
+		}
+	}
+
+	void push_back(const T& value)
+	{
+		emplace_back(value);
+	}
+
+	void push_back(T&& value)
+	{
+		emplace_back(std::move(value));
+	}
+
+	template <class... Args, class = std::enable_if_t<std::is_constructible_v<T, Args...>>>
+	void emplace_front(Args&&... args)
+	{
+		if (size() == capacity()) {
+			grow_emplace(true, std::forward<Args>(args)...);
+		}
+		else
+		{
+			emplace_front_no_grow(std::forward<Args>(args)...);
+		}
+	}
+
+	void push_front(const T& value)
+	{
+		emplace_front(value);
+	}
+
+	void push_front(T&& value)
+	{
+		emplace_front(std::move(value));
+	}
+
+	// call f with a std::span for each contiguous part of the queue, front to back
+	template <class Func>
+	void for_each_segment(Func&& f)
+	{
+		size_t first_size = first_segment_size();
+		if (first_size > 0)
+			f(std::span<T>(array + start(), first_size));
+		if (size() > first_size)
+			f(std::span<T>(array, size() - first_size));
+	}
+
+	template <class Func>
+	void for_each_segment(Func&& f) const
+	{
+		size_t first_size = first_segment_size();
+		if (first_size > 0)
+			f(std::span<const T>(array + start(), first_size));
+		if (size() > first_size)
+			f(std::span<const T>(array, size() - first_size));
+	}
+
+	// Sorts the elements in place. They are first gathered into one contiguous run, which moves
+	// at most the number of free slots, and then sorted through raw pointers. Arithmetic types
+	// sorted with std::less or std::greater use a radix sort
+	template <class Compare = std::less<>>
+	void sort(Compare comp = {})
+	{
+		if constexpr (std::is_nothrow_move_constructible_v<T>)
+		{
+			gather_unordered();
+			auto scratch = sort_scratch<Compare>(size());
+			sort_range(array + start(), array + start() + size(), comp, scratch.get());
+		}
+		else
+		{
+			std::sort(begin(), end(), comp);
+		}
+	}
+
+	void clear()
+	{
+		for_each_index([this](size_t ix)
+			{
+				destroy(&array[ix]);
+			});
+		set_start(0);
+		_size = 0;
+	}
+
+	void reserve(size_t new_capacity)
+	{
+		if (new_capacity > capacity()) {
+			realloc(fit_capacity(new_capacity));
+		}
+	}
+
+	// release the unused capacity, as much as the growth policy allows
+	void shrink_to_fit()
+	{
+		size_t new_capacity = fit_capacity(size());
+		if (new_capacity >= capacity())
+			return;
+		if (new_capacity == 0)
+		{
+			alloc_traits::deallocate(alloc, array, capacity());
+			array = nullptr;
+			set_capacity(0);
+			set_start(0);
+		}
+		else
+		{
+			realloc(new_capacity);
+		}
+	}
+
+	void pop_front()
+	{
+		destroy(&(*this)[0]);
+		set_start(wrap_up(1));
+		--_size;
+		shrink_after_pop();
+	}
+
+	void pop_back()
+	{
+		destroy(&(*this)[_size - 1]);
+		--_size;
+		shrink_after_pop();
+	}
+	
+	constexpr size_t size() const
+	{
+		return _size;
+	}
+
+	constexpr size_t capacity() const
+	{
+		return layout.capacity();
+	}
+
+	size_t max_size() const
+	{
+		return std::min(layout_type::max_capacity, alloc_traits::max_size(alloc));
+	}
+
+	allocator_type get_allocator() const
+	{
+		return alloc;
+	}
+
+	template <class V>
+	void erase(iter_templ<V> first, iter_templ<V> last)
+	{
+		size_t n = last - first;
+		if (n == size()) {
+			clear();
+			return;
+		}
+		if (end() - last <= ptrdiff_t(size() / 2))
+		{
+			while (first + n < end())
+			{
+				*first = std::move(*(first + n));
+				++first;
+			}
+			while (n > 0)
+			{
+				pop_back();
+				--n;
+			}
+		}
+		else
+		{
+			if (first != begin())
+			{
+				do
+				{
+					--first;
+					*(first + n) = std::move(*first);
+				} while (first != begin());
+			}
+			while (n > 0)
+			{
+				pop_front();
+				--n;
+			}
+		}
+	}
+
+	template <class V>
+	void erase(iter_templ<V> pos)
+	{
+		erase(pos, pos + 1);
+	}
+
+
+	template <class V, class Iter>
+	iterator insert(iter_templ<V> where, Iter first, Iter last)
+	{
+		if (first == last)
+			return where;
+		size_t n = std::distance(first, last);
+		if (n + size() > capacity())
+		{
+			auto tmp = empty_copy();
+			tmp.reserve(std::max(n + size(), next_capacity()));
+			tmp.set_start(where - begin());
+			auto first_inserted = tmp.start();
+
+			// insert the new range first in case of an exception
+			for (auto it = first; it != last; ++it)
+			{
+				construct(&tmp.array[tmp.start() + tmp._size], *it);
+				++tmp._size;
+			}
+
+			// move the last part from the current vector_queue
+			for (auto it = where; it != end(); ++it)
+			{
+				construct(&tmp.array[tmp.start() + tmp._size], std::move(*it));
+				++tmp._size;
+			}
+
+			for (auto it = std::reverse_iterator<iterator>(where); it != rend(); ++it)
+			{
+				construct(&tmp.array[tmp.start() - 1], std::move(*it));
+				tmp.set_start(tmp.start() - 1);
+				++tmp._size;
+			}
+
+			swap(tmp);
+			return { first_inserted, *this };
+		}
+		if (size_t(where - begin()) < size() / 2)
+		{
+			if (where == begin())
+			{
+				insert_n_front(n, first);
+				return begin();
+			}
+
+			// insert n empty values, iterators point to elements so go by position from here
+			size_t pos = where - begin();
+			for (size_t i = 0; i < n; ++i)
+			{
+				emplace_front_no_grow();
+			}
+			for (size_t i = n; i < pos + n; ++i)
+			{
+				(*this)[i - n] = std::move((*this)[i]);
+			}
+
+			iterator insert_place = begin() + pos;
+
+			for (size_t i = 0; i < n; ++i)
+			{
+				*(insert_place + i) = *first;
+				++first;
+			}
+			return insert_place;
+		}
+		else
+		{
+			if (where == end())
+			{
+				std::for_each(first, last, [this](auto& value)
+					{
+						emplace_back_no_grow(value);
+					});
+				return end() - n;
+			}
+
+			// insert n empty values, iterators point to elements so go by position from here
+			size_t pos = where - begin();
+			for (size_t i = 0; i < n; ++i)
+			{
+				emplace_back_no_grow();
+			}
+			for (size_t i = size() - n; i-- > pos;)
+			{
+				(*this)[i + n] = std::move((*this)[i]);
+			}
+
+			iterator insert_place = begin() + pos;
+
+			for (size_t i = 0; i < n; ++i)
+			{
+				*(insert_place + i) = *first;
+				++first;
+			}
+			return insert_place;
+		}
+	}
+
+	template <class V, class... Args, class = std::enable_if_t<std::is_constructible_v<T, Args...>>>
+	iterator emplace(iter_templ<V> where, Args&&... args)
+	{
+		if (size() == capacity())
+		{
+			auto tmp = empty_copy();
+			tmp.reserve(next_capacity());
+			tmp.set_start(where - begin());
+			auto first_inserted = tmp.start();
+
+			// construct the value first in case of an exception
+			construct(&tmp.array[tmp.start() + tmp._size], std::forward<Args>(args)...);
+			++tmp._size;
+
+			// move the last part from the current vector_queue
+			for (auto it = where; it != end(); ++it)
+			{
+				construct(&tmp.array[tmp.start() + tmp._size], std::move(*it));
+				++tmp._size;
+			}
+
+			for (auto it = std::reverse_iterator<iterator>(where); it != rend(); ++it)
+			{
+				construct(&tmp.array[tmp.start() - 1], std::move(*it));
+				tmp.set_start(tmp.start() - 1);
+				++tmp._size;
+			}
+
+			swap(tmp);
+			return { first_inserted, *this };
+		}
+		if (where == begin())
+		{
+			emplace_front_no_grow(std::forward<Args>(args)...);
+			return begin();
+		}
+		if (where == end())
+		{
+			emplace_back_no_grow(std::forward<Args>(args)...);
+			return --end();
+		}
+		size_t pos = where - begin();
+		if (pos < size() / 2)
+		{
+			emplace_front_no_grow(std::move(front()));
+			// the elements before pos move one step to the front
+			for (size_t i = 1; i < pos; ++i)
+			{
+				(*this)[i] = std::move((*this)[i + 1]);
+			}
+		}
+		else
+		{
+			emplace_back_no_grow(std::move(back()));
+			for (size_t i = size() - 2; i > pos; --i)
+			{
+				(*this)[i] = std::move((*this)[i - 1]);
+			}
+		}
+		(*this)[pos] = T{ std::forward<Args>(args)... };
+		return begin() + pos;
+	}
+
+	template <class V>
+	iterator insert(iter_templ<V> where, const T& value)
+	{
+		return emplace(where, value);
+	}
+
+	template <class V>
+	iterator insert(iter_templ<V> where, T&& value)
+	{
+		return emplace(where, std::move(value));
+	}
+
+	void swap(vector_queue& other) noexcept(alloc_traits::propagate_on_container_swap::value
+		|| alloc_traits::is_always_equal::value)
+	{
+		std::swap(array, other.array);
+		std::swap(layout, other.layout);
+		std::swap(_size, other._size);
+		if constexpr (alloc_traits::propagate_on_container_swap::value)
+			std::swap(alloc, other.alloc);
+		std::swap(growth, other.growth);
+	}
+
+	// Keeps a copy of the buffer pointer and the capacity so dereferencing doesn't have to reload them
+	// through the container, which the compiler can't hoist out of loops that write through a char*.
+	template <class V>
+	struct iter_templ
+	{
+		typedef ptrdiff_t difference_type;
+		typedef T value_type;
+		typedef V* pointer;
+		typedef V& reference;
+		typedef std::random_access_iterator_tag iterator_category;
+		using container_type = std::conditional_t<std::is_const_v<V>, const vector_queue, vector_queue>;
+
+		V& operator*() const { return base[wrap(start + index, capacity)]; }
+		V* operator->() const { return &**this; }
+		V& operator[](ptrdiff_t diff) const { return base[wrap(start + index + diff, capacity)]; }
+
+		iter_templ<V>& operator++()
+		{
+			++index;
+			return *this;
+		}
+
+		iter_templ<V> operator++(int)
+		{
+			auto tmp = *this;
+			++index;
+			return tmp;
+		}
+
+		iter_templ<V>& operator--()
+		{
+			--index;
+			return *this;
+		}
+
+		iter_templ<V> operator--(int)
+		{
+			auto tmp = *this;
+			--index;
+			return tmp;
+		}
+
+		bool operator!=(const iter_templ<V>& other) const
+		{
+			return index != other.index;
+		}
+
+		bool operator==(const iter_templ<V>& other) const
+		{
+			return index == other.index;
+		}
+
+		ptrdiff_t operator-(const iter_templ<V>& other) const
+		{
+			return ptrdiff_t(index - other.index);
+		}
+
+		iter_templ<V>& operator+=(ptrdiff_t diff)
+		{
+			index += diff;
+			return *this;
+		}
+
+		iter_templ<V>& operator-=(ptrdiff_t diff)
+		{
+			index -= diff;
+			return *this;
+		}
+
+		iter_templ<V> operator+(ptrdiff_t diff) const
+		{
+			auto tmp = *this;
+			return tmp += diff;
+		}
+
+		friend iter_templ<V> operator+(ptrdiff_t diff, const iter_templ<V>& it)
+		{
+			return it + diff;
+		}
+
+		iter_templ<V> operator-(ptrdiff_t diff) const
+		{
+			auto tmp = *this;
+			return tmp -= diff;
+		}
+
+		std::strong_ordering operator<=>(const iter_templ& other) const
+		{
+			return index <=> other.index;
+		}
+
+		operator iter_templ<const T>() const
+		{
+			return { base, start, capacity, index };
+		}
+
+		iter_templ() = default;
+		iter_templ(size_t index, container_type& container) : base(container.array), start(container.start()),
+			capacity(container.capacity()), index(index) {}
+		iter_templ(V* base, size_t start, size_t capacity, size_t index) : base(base), start(start), capacity(capacity), index(index) {}
+	private:
+		V* base = nullptr;
+		size_t start = 0;
+		size_t capacity = 0;
+		size_t index = 0;
+	};
+
+private:
+	template <class CharT, class Traits, class A> friend class basic_vector_queue_streambuf;
+	template <class A> friend class record_queue;
+	template <class A> friend class task_queue;
+	template <class U, class... Params, class Compare> friend void vq::sort(const vq::parallel_policy&, vector_queue<U, Params...>&, Compare);
+
+	using layout_type = vq::detail::ring_layout<!std::is_same_v<SizeType, size_t>>;
+	using alloc_traits = std::allocator_traits<Alloc>;
+
+	T* array;
+	SizeType _size;
+	layout_type layout;
+	[[no_unique_address]] Alloc alloc;
+	[[no_unique_address]] GrowthPolicy growth;
+	
+	
+	void realloc(size_t new_capacity)
+	{
+		auto tmp = empty_copy();
+		tmp.array = alloc_traits::allocate(this->alloc, new_capacity);
+		tmp.set_capacity(new_capacity);
+		for_each_index([this, &tmp](size_t ix)
+			{
+				construct(&tmp.array[tmp._size++], std::move(array[ix]));
+				destroy(&array[ix]);
+			});
+		_size = 0; // the old buffer is released by tmp
+		swap(tmp);
+	}
+
+	// number of elements before the ring wraps around
+	size_t first_segment_size() const
+	{
+		return std::min(size(), capacity() - start());
+	}
+
+	// Move the elements into one contiguous run without keeping their order. The elements outside
+	// either [0, size) or [capacity - size, capacity) are moved into the free slots inside it
+	void gather_unordered() noexcept
+	{
+		size_t first_size = first_segment_size();
+		size_t second_size = size() - first_size;
+		if (second_size == 0)
+			return;
+		size_t gap = capacity() - size();
+		auto move = [this](size_t from, size_t to)
+		{
+			construct(&array[to], std::move(array[from]));
+			destroy(&array[from]);
+		};
+		if (std::min(first_size, gap) <= std::min(second_size, gap))
+		{
+			size_t to = second_size;
+			for (size_t from = std::max(start(), size()); from < capacity(); ++from)
+				move(from, to++);
+			set_start(0);
+		}
+		else
+		{
+			size_t to = std::max(gap, second_size);
+			for (size_t from = 0; from < std::min(second_size, gap); ++from)
+				move(from, to++);
+			set_start(gap);
+		}
+	}
+
+	template <class Compare>
+	static constexpr bool radix_sortable = std::is_arithmetic_v<T> && !std::is_same_v<T, bool> && std::has_single_bit(sizeof(T)) && sizeof(T) <= 8
+		&& (std::is_same_v<Compare, std::less<>> || std::is_same_v<Compare, std::less<T>>
+			|| std::is_same_v<Compare, std::greater<>> || std::is_same_v<Compare, std::greater<T>>);
+
+	template <class Compare>
+	void sort_range(T* first, T* last, Compare& comp, T* scratch)
+	{
+		if constexpr (radix_sortable<Compare>)
+		{
+			if (size_t(last - first) >= radix_sort_min)
+			{
+				radix_sort(first, last, scratch);
+				if constexpr (std::is_same_v<Compare, std::greater<>> || std::is_same_v<Compare, std::greater<T>>)
+					std::reverse(first, last);
+				return;
+			}
+		}
+		std::sort(first, last, comp);
+	}
+
+	// least significant byte first, passes where all elements have the same byte are skipped
+	static constexpr size_t radix_sort_min = 256;
+
+	// The buffer radix_sort needs for up to n elements, or null if it won't be used. It comes from
+	// std::allocator so a sort neither uses up an arena nor calls the queue's allocator from the
+	// threads of a parallel sort.
+	template <class Compare>
+	static std::unique_ptr<T[]> sort_scratch(size_t n)
+	{
+		if constexpr (radix_sortable<Compare>)
+		{
+			if (n >= radix_sort_min)
+				return std::make_unique_for_overwrite<T[]>(n);
+		}
+		return nullptr;
+	}
+
+	// scratch holds at least last - first elements
+	static void radix_sort(T* first, T* last, T* scratch)
+	{
+		using U = std::conditional_t<sizeof(T) == 1, uint8_t, std::conditional_t<sizeof(T) == 2, uint16_t,
+			std::conditional_t<sizeof(T) == 4, uint32_t, uint64_t>>>;
+		constexpr U sign = U(U(1) << (sizeof(T) * 8 - 1));
+		// map the values to unsigned integers that sort in the same order
+		auto key = [](T value)
+		{
+			U bits = std::bit_cast<U>(value);
+			if constexpr (std::is_floating_point_v<T>)
+				return U(bits & sign ? ~bits : bits | sign);
+			else if constexpr (std::is_signed_v<T>)
+				return U(bits ^ sign);
+			else
+				return bits;
+		};
+		size_t n = last - first;
+		size_t counts[sizeof(T)][256] = {};
+		for (T* p = first; p != last; ++p)
+		{
+			U k = key(*p);
+			for (size_t byte = 0; byte < sizeof(T); ++byte)
+				++counts[byte][(k >> (byte * 8)) & 0xff];
+		}
+		T* from = first;
+		T* to = scratch;
+		for (size_t byte = 0; byte < sizeof(T); ++byte)
+		{
+			if (counts[byte][(key(*first) >> (byte * 8)) & 0xff] == n)
+				continue;
+			size_t offsets[256];
+			size_t offset = 0;
+			for (size_t b = 0; b < 256; ++b)
+			{
+				offsets[b] = offset;
+				offset += counts[byte][b];
+			}
+			for (T* p = from; p != from + n; ++p)
+				to[offsets[(key(*p) >> (byte * 8)) & 0xff]++] = *p;
+			std::swap(from, to);
+		}
+		if (from != first)
+			std::copy(from, from + n, first);
+	}
+
+	// run a forward search kernel over both segments, the index of the match or size()
+	template <class Kernel>
+	size_t find_in_segments(Kernel&& kernel) const
+	{
+		size_t first_size = first_segment_size();
+		auto found = kernel(array + start(), array + start() + first_size);
+		if (found != array + start() + first_size)
+			return size_t(found - array) - start();
+		return size_t(kernel(array, array + size() - first_size) - array) + first_size;
+	}
+
+	// run a backward search kernel over both segments, the index of the match or size()
+	template <class Kernel>
+	size_t rfind_in_segments(Kernel&& kernel) const
+	{
+		size_t first_size = first_segment_size();
+		auto second_end = array + size() - first_size;
+		auto found = kernel(array, second_end);
+		if (found != second_end)
+			return size_t(found - array) + first_size;
+		found = kernel(array + start(), array + start() + first_size);
+		if (found != array + start() + first_size)
+			return size_t(found - array) - start();
+		return size();
+	}
+
+	size_t find_index(const T& value) const
+	{
+#ifdef VECTOR_QUEUE_SIMD
+		if constexpr (vq::simd::has_kernels<T>)
+		{
+			if (size() * sizeof(T) >= 32)
+			{
+				auto kernel = vq::simd::find_kernel<T>();
+				return find_in_segments([&](const T* first, const T* last) { return kernel(first, last, value); });
+			}
+		}
+#endif
+		return find_if_index([&value](const T& x) { return x == value; });
+	}
+
+	template <class Pred>
+	size_t find_if_index(Pred&& pred) const
+	{
+		size_t first_size = first_segment_size();
+		for (size_t i = start(); i < start() + first_size; ++i)
+			if (pred(array[i]))
+				return i - start();
+		for (size_t i = 0; i < size() - first_size; ++i)
+			if (pred(array[i]))
+				return i + first_size;
+		return size();
+	}
+
+	size_t rfind_index(const T& value) const
+	{
+#ifdef VECTOR_QUEUE_SIMD
+		if constexpr (vq::simd::has_kernels<T>)
+		{
+			if (size() * sizeof(T) >= 32)
+			{
+				auto kernel = vq::simd::rfind_kernel<T>();
+				return rfind_in_segments([&](const T* first, const T* last) { return kernel(first, last, value); });
+			}
+		}
+#endif
+		return find_last_if_index([&value](const T& x) { return x == value; });
+	}
+
+	template <class Pred>
+	size_t find_last_if_index(Pred&& pred) const
+	{
+		size_t first_size = first_segment_size();
+		for (size_t i = size() - first_size; i-- > 0;)
+			if (pred(array[i]))
+				return i + first_size;
+		for (size_t i = start() + first_size; i-- > start();)
+			if (pred(array[i]))
+				return i - start();
+		return size();
+	}
+
+	size_t find_any_of_index(std::initializer_list<T> values) const
+	{
+#ifdef VECTOR_QUEUE_SIMD
+		if constexpr (vq::simd::has_kernels<T>)
+		{
+			if (size() * sizeof(T) >= 32 && values.size() <= vq::simd::max_any_of)
+			{
+				auto kernel = vq::simd::find_any_of_kernel<T>();
+				return find_in_segments([&](const T* first, const T* last) { return kernel(first, last, values.begin(), values.size()); });
+			}
+		}
+#endif
+		return find_if_index([&values](const T& x) { return std::find(values.begin(), values.end(), x) != values.end(); });
+	}
+
+	template <class Func>
+	void for_each_index(Func&& f)
+	{
+		if (start() + size() > capacity()) {// wrapping
+			for (size_t i = start(); i < capacity(); ++i)
+				f(i);
+			auto end = start() + size() - capacity();
+			for (size_t i = 0; i < end; ++i)
+				f(i);
+		}
+		else
+		{
+			auto end = start() + size();
+			for (size_t i = start(); i < end; ++i)
+				f(i);
+		}
+	}
+
+	constexpr size_t start() const
+	{
+		return layout.start();
+	}
+
+	constexpr void set_start(size_t start)
+	{
+		layout.set_start(start);
+	}
+
+	constexpr void set_capacity(size_t capacity)
+	{
+		layout.set_capacity(capacity);
+	}
+
+	size_t next_capacity() const
+	{
+		return check_capacity(growth.next_capacity(capacity(), sizeof(T)));
+	}
+
+	size_t fit_capacity(size_t n) const
+	{
+		return n == 0 ? 0 : check_capacity(growth.fit_capacity(n, sizeof(T)));
+	}
+
+	static size_t check_capacity(size_t capacity)
+	{
+		if (capacity > layout_type::max_capacity)
+		{
+#ifndef VECTOR_QUEUE_NO_EXCEPTIONS
+			throw std::length_error("vector_queue capacity exceeds max_size()");
+#else
+			std::abort();
+#endif
+		}
+		return capacity;
+	}
+
+	template <class... Args>
+	void construct(T* element, Args&&... args)
+	{
+		alloc_traits::construct(alloc, element, std::forward<Args>(args)...);
+	}
+
+	void destroy(T* element)
+	{
+		alloc_traits::destroy(alloc, element);
+	}
+
+	// swap everything but the allocator and the growth policy
+	void swap_buffers(vector_queue& other) noexcept
+	{
+		std::swap(array, other.array);
+		std::swap(_size, other._size);
+		std::swap(layout, other.layout);
+	}
+
+	// destroy the elements and free the buffer
+	// the buffer of a new queue for n elements, none for 0 so copies of empty queues don't allocate
+	void allocate_for(size_t n)
+	{
+		if (n == 0)
+			return;
+		set_capacity(fit_capacity(n));
+		array = alloc_traits::allocate(alloc, capacity());
+	}
+
+	void release()
+	{
+		clear();
+		if (array)
+			alloc_traits::deallocate(alloc, array, capacity());
+		array = nullptr;
+		set_capacity(0);
+	}
+
+	// an empty queue with the same allocator and growth policy to build a new buffer in and swap with
+	vector_queue empty_copy() const
+	{
+		vector_queue tmp(alloc);
+		tmp.growth = growth;
+		return tmp;
+	}
+
+	// with a policy like vq::shrink_after_bursts, ask it whether to shrink after a pop
+	void shrink_after_pop()
+	{
+		if constexpr (requires { growth.shrink_capacity(size(), capacity(), sizeof(T)); })
+		{
+			size_t new_capacity = growth.shrink_capacity(size(), capacity(), sizeof(T));
+			if (new_capacity < capacity())
+				realloc(new_capacity);
+		}
+	}
+
+	// grow and add an element at the front or back. The element is constructed before the old ones
+	// are moved since args may refer to one of them, e.g. push_back(front())
+	template <class... Args>
+	void grow_emplace(bool front, Args&&... args)
+	{
+		size_t new_capacity = next_capacity();
+		auto tmp = empty_copy();
+		tmp.array = alloc_traits::allocate(this->alloc, new_capacity);
+		tmp.set_capacity(new_capacity);
+		size_t slot = front ? new_capacity - 1 : size(); // the front wraps around
+		construct(&tmp.array[slot], std::forward<Args>(args)...);
+		tmp.set_start(slot);
+		tmp._size = 1;
+		size_t i = 0;
+		for_each_index([this, &tmp, &i](size_t ix)
+			{
+				construct(&tmp.array[i++], std::move(array[ix]));
+				destroy(&array[ix]);
+			});
+		tmp.set_start(front ? slot : 0);
+		tmp._size = size() + 1;
+		_size = 0; // the old buffer is released by tmp
+		swap(tmp);
+	}
+
+	void grow()
+	{
+		if (!array)
+		{
+			array = alloc_traits::allocate(alloc, next_capacity());
+			set_capacity(next_capacity());
+		}
+		else
+		{
+			realloc(next_capacity());
+		}
+	}
+
+	template <class... Args>
+	void emplace_front_no_grow(Args&&... args)
+	{
+		construct(&array[wrap_down(1)], std::forward<Args>(args)...);
+		set_start(wrap_down(1));
+		++_size;
+	}
+
+
+	template <class... Args>
+	void emplace_back_no_grow(Args&&... args)
+	{
+		construct(&array[wrap_up(_size)], std::forward<Args>(args)...);
+		++_size;
+	}
+
+	template <class Iter>
+	void insert_n_front(size_t n, Iter first)
+	{
+		for (size_t i = 0; i < n; ++i)
+		{
+#ifndef VECTOR_QUEUE_NO_EXCEPTIONS
+			try {
+#endif
+				size_t index = wrap_down(n - i);
+				construct(&array[index], *first);
+				++first;
+#ifndef VECTOR_QUEUE_NO_EXCEPTIONS
+			}
+			catch (...)
+			{
+				for (size_t j = 0; j < i; ++j)
+					destroy(&array[wrap_down(n - j)]);
+				throw;
+			}
+#endif
+		}
+		_size += n;
+		set_start(wrap_down(n));
+	}
+
+};
+
+namespace vq::pmr
+{
+	template <class T, class GrowthPolicy = vq::double_growth, class SizeType = size_t>
+	using vector_queue = ::vector_queue<T, std::pmr::polymorphic_allocator<T>, GrowthPolicy, SizeType>;
+}
+
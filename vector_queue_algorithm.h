@@ -0,0 +1,464 @@
+#pragma once
+/*
+Copyright (c) 2021 Christian Olsson
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#include <cstring>
+#include <array>
+#include <atomic>
+#include <exception>
+#include <numeric>
+#include <optional>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "vector_queue.h"
+
+// Overloads of the standard algorithms that run over the contiguous segments of a vector_queue
+// instead of going through its iterators, so the compiler sees plain pointer loops.
+namespace vq
+{
+	// the one or two contiguous parts of the queue, front to back, the second may be empty
+	template <class T, class... Params>
+	std::array<std::span<const T>, 2> segments(const vector_queue<T, Params...>& queue)
+	{
+		std::array<std::span<const T>, 2> result;
+		size_t i = 0;
+		queue.for_each_segment([&](std::span<const T> segment)
+			{
+				result[i++] = segment;
+			});
+		return result;
+	}
+
+	template <class T, class... Params>
+	std::array<std::span<T>, 2> segments(vector_queue<T, Params...>& queue)
+	{
+		std::array<std::span<T>, 2> result;
+		size_t i = 0;
+		queue.for_each_segment([&](std::span<T> segment)
+			{
+				result[i++] = segment;
+			});
+		return result;
+	}
+
+	template <class T, class... Params, class Func>
+	Func for_each(vector_queue<T, Params...>& queue, Func f)
+	{
+		queue.for_each_segment([&](std::span<T> segment)
+			{
+				for (auto& value : segment)
+					f(value);
+			});
+		return f;
+	}
+
+	template <class T, class... Params, class Func>
+	Func for_each(const vector_queue<T, Params...>& queue, Func f)
+	{
+		queue.for_each_segment([&](std::span<const T> segment)
+			{
+				for (auto& value : segment)
+					f(value);
+			});
+		return f;
+	}
+
+	template <class T, class... Params>
+	void fill(vector_queue<T, Params...>& queue, const T& value)
+	{
+		bool bytewise = false;
+		if constexpr (std::is_trivially_copyable_v<T>)
+		{
+			// memset works when every byte of the value is the same, e.g. for zero
+			unsigned char bytes[sizeof(T)];
+			std::memcpy(bytes, &value, sizeof(T));
+			bytewise = std::all_of(bytes, bytes + sizeof(T), [&](unsigned char b) { return b == bytes[0]; });
+			if (bytewise)
+				queue.for_each_segment([&](std::span<T> segment)
+					{
+						std::memset(segment.data(), bytes[0], segment.size_bytes());
+					});
+		}
+		if (!bytewise)
+			queue.for_each_segment([&](std::span<T> segment)
+				{
+					std::fill(segment.begin(), segment.end(), value);
+				});
+	}
+
+	// copy the queue to out, returns the end of the output
+	template <class T, class... Params, class OutputIt>
+	OutputIt copy(const vector_queue<T, Params...>& queue, OutputIt out)
+	{
+		queue.for_each_segment([&](std::span<const T> segment)
+			{
+				if constexpr (std::is_trivially_copyable_v<T> && std::is_same_v<OutputIt, T*>)
+				{
+					if (!segment.empty())
+						std::memcpy(out, segment.data(), segment.size_bytes());
+					out += segment.size();
+				}
+				else
+					out = std::copy(segment.begin(), segment.end(), out);
+			});
+		return out;
+	}
+
+	template <class T, class... Params, class OutputIt, class UnaryOp>
+	OutputIt transform(const vector_queue<T, Params...>& queue, OutputIt out, UnaryOp op)
+	{
+		queue.for_each_segment([&](std::span<const T> segment)
+			{
+				out = std::transform(segment.begin(), segment.end(), out, op);
+			});
+		return out;
+	}
+
+	// replace every element with op(element)
+	template <class T, class... Params, class UnaryOp>
+	void transform(vector_queue<T, Params...>& queue, UnaryOp op)
+	{
+		queue.for_each_segment([&](std::span<T> segment)
+			{
+				std::transform(segment.begin(), segment.end(), segment.begin(), op);
+			});
+	}
+
+	template <class T, class... ParamsA, class... ParamsB>
+	bool equal(const vector_queue<T, ParamsA...>& a, const vector_queue<T, ParamsB...>& b)
+	{
+		if (a.size() != b.size())
+			return false;
+		// the segments of a and b split at different places, compare the overlapping pieces
+		auto sa = segments(a);
+		auto sb = segments(b);
+		size_t ia = 0, ib = 0;
+		std::span<const T> pa = sa[0], pb = sb[0];
+		while (ia < 2 && ib < 2)
+		{
+			if (pa.empty())
+			{
+				if (++ia < 2)
+					pa = sa[ia];
+				continue;
+			}
+			if (pb.empty())
+			{
+				if (++ib < 2)
+					pb = sb[ib];
+				continue;
+			}
+			size_t n = std::min(pa.size(), pb.size());
+			if (!std::equal(pa.begin(), pa.begin() + n, pb.begin()))
+				return false;
+			pa = pa.subspan(n);
+			pb = pb.subspan(n);
+		}
+		return true;
+	}
+
+	// Run the parallel overloads below on up to threads threads. A queue is split into equal chunks
+	// of at least min_chunk elements, so small queues run on the calling thread only.
+	struct parallel_policy
+	{
+		unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+		size_t min_chunk = 1 << 16;
+	};
+
+	inline const parallel_policy par{};
+
+	namespace detail
+	{
+		// how many chunks a parallel algorithm splits size elements into
+		inline size_t chunk_count(const parallel_policy& policy, size_t size)
+		{
+			return std::min<size_t>(std::max(1u, policy.threads), std::max<size_t>(1, size / std::max<size_t>(1, policy.min_chunk)));
+		}
+
+		// call f(chunk, first, last) for consecutive chunks of [0, size), one per thread, the first on
+		// the calling thread. The first exception thrown by f is rethrown when all chunks are done
+		template <class Func>
+		void parallel_chunks(size_t chunks, size_t size, Func&& f)
+		{
+			if (chunks == 1)
+			{
+				f(size_t(0), size_t(0), size);
+				return;
+			}
+#ifndef VECTOR_QUEUE_NO_EXCEPTIONS
+			std::vector<std::exception_ptr> errors(chunks);
+#endif
+			auto run = [&](size_t chunk)
+			{
+#ifndef VECTOR_QUEUE_NO_EXCEPTIONS
+				try {
+#endif
+					f(chunk, size * chunk / chunks, size * (chunk + 1) / chunks);
+#ifndef VECTOR_QUEUE_NO_EXCEPTIONS
+				}
+				catch (...)
+				{
+					errors[chunk] = std::current_exception();
+				}
+#endif
+			};
+			{
+				std::vector<std::jthread> threads;
+				threads.reserve(chunks - 1);
+				for (size_t chunk = 1; chunk < chunks; ++chunk)
+					threads.emplace_back(run, chunk);
+				run(0);
+			}
+#ifndef VECTOR_QUEUE_NO_EXCEPTIONS
+			for (auto& error : errors)
+				if (error)
+					std::rethrow_exception(error);
+#endif
+		}
+
+		template <class Func>
+		void parallel_chunks(const parallel_policy& policy, size_t size, Func&& f)
+		{
+			parallel_chunks(chunk_count(policy, size), size, std::forward<Func>(f));
+		}
+
+		// call f(span, index of the first element in the span) for the parts of [first, last) in each segment
+		template <class T, class Func>
+		void for_each_span(const std::array<std::span<T>, 2>& segments, size_t first, size_t last, Func&& f)
+		{
+			size_t split = segments[0].size();
+			if (first < split)
+				f(segments[0].subspan(first, std::min(last, split) - first), first);
+			if (last > split)
+			{
+				size_t from = std::max(first, split);
+				f(segments[1].subspan(from - split, last - from), from);
+			}
+		}
+
+		// the index of the first element matching pred or size(). Chunks are searched in blocks and
+		// stop as soon as a match has been found before the block they are about to search
+		template <class T, class... Params, class Pred>
+		size_t find_if_index(const parallel_policy& policy, const vector_queue<T, Params...>& queue, Pred pred)
+		{
+			constexpr size_t block = 4096;
+			std::atomic<size_t> found = queue.size();
+			auto segs = segments(queue);
+			parallel_chunks(policy, queue.size(), [&](size_t, size_t first, size_t last)
+				{
+					for_each_span(segs, first, last, [&](std::span<const T> span, size_t offset)
+						{
+							for (size_t from = 0; from < span.size(); from += block)
+							{
+								if (found.load(std::memory_order_relaxed) < offset + from)
+									return;
+								auto to = span.begin() + std::min(span.size(), from + block);
+								auto it = std::find_if(span.begin() + from, to, pred);
+								if (it != to)
+								{
+									size_t index = offset + (it - span.begin());
+									size_t current = found.load(std::memory_order_relaxed);
+									while (index < current && !found.compare_exchange_weak(current, index, std::memory_order_relaxed))
+									{}
+									return;
+								}
+							}
+						});
+				});
+			return found.load();
+		}
+	}
+
+	template <class T, class... Params, class Pred>
+	typename vector_queue<T, Params...>::iterator find_if(const parallel_policy& policy, vector_queue<T, Params...>& queue, Pred pred)
+	{
+		return queue.begin() + detail::find_if_index(policy, std::as_const(queue), pred);
+	}
+
+	template <class T, class... Params, class Pred>
+	typename vector_queue<T, Params...>::const_iterator find_if(const parallel_policy& policy, const vector_queue<T, Params...>& queue, Pred pred)
+	{
+		return queue.begin() + detail::find_if_index(policy, queue, pred);
+	}
+
+	template <class T, class... Params>
+	typename vector_queue<T, Params...>::iterator find(const parallel_policy& policy, vector_queue<T, Params...>& queue, const T& value)
+	{
+		return find_if(policy, queue, [&](const T& element) { return element == value; });
+	}
+
+	template <class T, class... Params>
+	typename vector_queue<T, Params...>::const_iterator find(const parallel_policy& policy, const vector_queue<T, Params...>& queue, const T& value)
+	{
+		return find_if(policy, queue, [&](const T& element) { return element == value; });
+	}
+
+	// combine the elements with op in order per chunk, then combine the chunk results in order,
+	// so op has to be associative but doesn't have to be commutative
+	template <class T, class... Params, class U, class BinaryOp>
+	U reduce(const parallel_policy& policy, const vector_queue<T, Params...>& queue, U init, BinaryOp op)
+	{
+		auto segs = segments(queue);
+		size_t chunks = detail::chunk_count(policy, queue.size());
+		std::vector<std::optional<U>> partial(chunks);
+		detail::parallel_chunks(chunks, queue.size(), [&](size_t chunk, size_t first, size_t last)
+			{
+				// the first chunk starts from init, the others from their first element
+				std::optional<U> total;
+				if (chunk == 0)
+					total.emplace(init);
+				detail::for_each_span(segs, first, last, [&](std::span<const T> span, size_t)
+					{
+						for (auto& value : span)
+						{
+							if (total)
+								total.emplace(op(std::move(*total), value));
+							else
+								total.emplace(value);
+						}
+					});
+				partial[chunk] = std::move(total);
+			});
+		U result = std::move(*partial[0]);
+		for (size_t chunk = 1; chunk < chunks; ++chunk)
+			result = op(std::move(result), std::move(*partial[chunk]));
+		return result;
+	}
+
+	template <class T, class... Params>
+	T reduce(const parallel_policy& policy, const vector_queue<T, Params...>& queue)
+	{
+		return reduce(policy, queue, T{}, std::plus<>());
+	}
+
+	template <class T, class... Params, class Pred>
+	size_t count_if(const parallel_policy& policy, const vector_queue<T, Params...>& queue, Pred pred)
+	{
+		auto segs = segments(queue);
+		size_t chunks = detail::chunk_count(policy, queue.size());
+		std::vector<size_t> partial(chunks);
+		detail::parallel_chunks(chunks, queue.size(), [&](size_t chunk, size_t first, size_t last)
+			{
+				size_t n = 0;
+				detail::for_each_span(segs, first, last, [&](std::span<const T> span, size_t)
+					{
+						n += std::count_if(span.begin(), span.end(), pred);
+					});
+				partial[chunk] = n;
+			});
+		return std::accumulate(partial.begin(), partial.end(), size_t(0));
+	}
+
+	template <class T, class... Params>
+	size_t count(const parallel_policy& policy, const vector_queue<T, Params...>& queue, const T& value)
+	{
+		return count_if(policy, queue, [&](const T& element) { return element == value; });
+	}
+
+	template <class T, class... Params, class Func>
+	void for_each(const parallel_policy& policy, vector_queue<T, Params...>& queue, Func f)
+	{
+		auto segs = segments(queue);
+		detail::parallel_chunks(policy, queue.size(), [&](size_t, size_t first, size_t last)
+			{
+				detail::for_each_span(segs, first, last, [&](std::span<T> span, size_t)
+					{
+						for (auto& value : span)
+							f(value);
+					});
+			});
+	}
+
+	// replace every element with op(element)
+	template <class T, class... Params, class UnaryOp>
+	void transform(const parallel_policy& policy, vector_queue<T, Params...>& queue, UnaryOp op)
+	{
+		auto segs = segments(queue);
+		detail::parallel_chunks(policy, queue.size(), [&](size_t, size_t first, size_t last)
+			{
+				detail::for_each_span(segs, first, last, [&](std::span<T> span, size_t)
+					{
+						std::transform(span.begin(), span.end(), span.begin(), op);
+					});
+			});
+	}
+
+	// write op(element) to out, which has to be random access so the chunks know where to write
+	template <class T, class... Params, class RandomIt, class UnaryOp>
+	RandomIt transform(const parallel_policy& policy, const vector_queue<T, Params...>& queue, RandomIt out, UnaryOp op)
+	{
+		auto segs = segments(queue);
+		detail::parallel_chunks(policy, queue.size(), [&](size_t, size_t first, size_t last)
+			{
+				detail::for_each_span(segs, first, last, [&](std::span<const T> span, size_t offset)
+					{
+						std::transform(span.begin(), span.end(), out + offset, op);
+					});
+			});
+		return out + queue.size();
+	}
+
+	// sort like vector_queue::sort with the chunks sorted on separate threads,
+	// then neighbouring chunks are merged pairwise in parallel until one run is left
+	template <class T, class... Params, class Compare>
+	void sort(const parallel_policy& policy, vector_queue<T, Params...>& queue, Compare comp)
+	{
+		size_t n = queue.size();
+		size_t chunks = detail::chunk_count(policy, n);
+		if constexpr (!std::is_nothrow_move_constructible_v<T>)
+			chunks = 1;
+		if (chunks == 1)
+		{
+			queue.sort(comp);
+			return;
+		}
+		queue.gather_unordered();
+		T* first = queue.array + queue.start();
+		// one buffer allocated here with a slice per chunk, the workers don't allocate
+		auto scratch = queue.template sort_scratch<Compare>(n);
+		detail::parallel_chunks(chunks, n, [&](size_t, size_t from, size_t to)
+			{
+				auto chunk_comp = comp;
+				queue.sort_range(first + from, first + to, chunk_comp, scratch ? scratch.get() + from : nullptr);
+			});
+		for (size_t width = 1; width < chunks; width *= 2)
+		{
+			size_t merges = (chunks + 2 * width - 1) / (2 * width);
+			detail::parallel_chunks(merges, merges, [&](size_t merge, size_t, size_t)
+				{
+					size_t low = merge * 2 * width;
+					size_t middle = low + width;
+					size_t high = std::min(low + 2 * width, chunks);
+					if (middle < chunks)
+						std::inplace_merge(first + n * low / chunks, first + n * middle / chunks, first + n * high / chunks, comp);
+				});
+		}
+	}
+
+	template <class T, class... Params>
+	void sort(const parallel_policy& policy, vector_queue<T, Params...>& queue)
+	{
+		sort(policy, queue, std::less<>());
+	}
+}
@@ -0,0 +1,220 @@
+/*
+Copyright (c) 2021 Christian Olsson
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// SIMD kernels over contiguous ranges, included by vector_queue.h once per instruction set.
+// VECTOR_QUEUE_SIMD_ISA names the namespace holding the ops for the instruction set and
+// VECTOR_QUEUE_SIMD_TARGET is the attribute that lets the compiler use it, so there is no include guard.
+
+namespace vq::simd::VECTOR_QUEUE_SIMD_ISA
+{
+	template <class T>
+	VECTOR_QUEUE_SIMD_TARGET const T* find(const T* first, const T* last, T value)
+	{
+		using o = ops<lane_t<T>>;
+		constexpr ptrdiff_t n = o::lanes;
+		const auto v = o::splat(std::bit_cast<lane_t<T>>(value));
+		for (; last - first >= 4 * n; first += 4 * n)
+		{
+			auto m0 = o::eq(o::load(first), v);
+			auto m1 = o::eq(o::load(first + n), v);
+			auto m2 = o::eq(o::load(first + 2 * n), v);
+			auto m3 = o::eq(o::load(first + 3 * n), v);
+			if (m0 | m1 | m2 | m3)
+			{
+				if (m0)
+					return first + std::countr_zero(m0) / o::mask_bits;
+				if (m1)
+					return first + n + std::countr_zero(m1) / o::mask_bits;
+				if (m2)
+					return first + 2 * n + std::countr_zero(m2) / o::mask_bits;
+				return first + 3 * n + std::countr_zero(m3) / o::mask_bits;
+			}
+		}
+		for (; last - first >= n; first += n)
+		{
+			if (auto m = o::eq(o::load(first), v))
+				return first + std::countr_zero(m) / o::mask_bits;
+		}
+		for (; first != last; ++first)
+			if (*first == value)
+				return first;
+		return last;
+	}
+
+	// the last element equal to value, or last if there is none
+	template <class T>
+	VECTOR_QUEUE_SIMD_TARGET const T* rfind(const T* first, const T* last, T value)
+	{
+		using o = ops<lane_t<T>>;
+		constexpr ptrdiff_t n = o::lanes;
+		const auto v = o::splat(std::bit_cast<lane_t<T>>(value));
+		const T* end = last;
+		for (; last - first >= 4 * n; last -= 4 * n)
+		{
+			auto m3 = o::eq(o::load(last - n), v);
+			auto m2 = o::eq(o::load(last - 2 * n), v);
+			auto m1 = o::eq(o::load(last - 3 * n), v);
+			auto m0 = o::eq(o::load(last - 4 * n), v);
+			if (m0 | m1 | m2 | m3)
+			{
+				if (m3)
+					return last - n + (std::bit_width(m3) - 1) / o::mask_bits;
+				if (m2)
+					return last - 2 * n + (std::bit_width(m2) - 1) / o::mask_bits;
+				if (m1)
+					return last - 3 * n + (std::bit_width(m1) - 1) / o::mask_bits;
+				return last - 4 * n + (std::bit_width(m0) - 1) / o::mask_bits;
+			}
+		}
+		for (; last - first >= n; last -= n)
+		{
+			if (auto m = o::eq(o::load(last - n), v))
+				return last - n + (std::bit_width(m) - 1) / o::mask_bits;
+		}
+		while (last != first)
+		{
+			--last;
+			if (*last == value)
+				return last;
+		}
+		return end;
+	}
+
+	template <class T>
+	VECTOR_QUEUE_SIMD_TARGET size_t count(const T* first, const T* last, T value)
+	{
+		using o = ops<lane_t<T>>;
+		constexpr ptrdiff_t n = o::lanes;
+		const auto v = o::splat(std::bit_cast<lane_t<T>>(value));
+		size_t bits = 0;
+		for (; last - first >= 4 * n; first += 4 * n)
+		{
+			bits += std::popcount(o::eq(o::load(first), v));
+			bits += std::popcount(o::eq(o::load(first + n), v));
+			bits += std::popcount(o::eq(o::load(first + 2 * n), v));
+			bits += std::popcount(o::eq(o::load(first + 3 * n), v));
+		}
+		for (; last - first >= n; first += n)
+			bits += std::popcount(o::eq(o::load(first), v));
+		size_t total = bits / o::mask_bits;
+		for (; first != last; ++first)
+			total += *first == value;
+		return total;
+	}
+
+	// the first element equal to any of the count values, count is at most max_any_of
+	template <class T>
+	VECTOR_QUEUE_SIMD_TARGET const T* find_any_of(const T* first, const T* last, const T* values, size_t count)
+	{
+		using o = ops<lane_t<T>>;
+		constexpr ptrdiff_t n = o::lanes;
+		typename o::vec v[max_any_of];
+		for (size_t j = 0; j < count; ++j)
+			v[j] = o::splat(std::bit_cast<lane_t<T>>(values[j]));
+		for (; last - first >= n; first += n)
+		{
+			auto data = o::load(first);
+			typename o::mask m = 0;
+			for (size_t j = 0; j < count; ++j)
+				m |= o::eq(data, v[j]);
+			if (m)
+				return first + std::countr_zero(m) / o::mask_bits;
+		}
+		for (; first != last; ++first)
+			for (size_t j = 0; j < count; ++j)
+				if (*first == values[j])
+					return first;
+		return last;
+	}
+
+	template <class T>
+	VECTOR_QUEUE_SIMD_TARGET T sum(const T* first, const T* last)
+	{
+		using o = arith<T>;
+		constexpr ptrdiff_t n = o::lanes;
+		auto a0 = o::splat(T{});
+		auto a1 = a0;
+		auto a2 = a0;
+		auto a3 = a0;
+		for (; last - first >= 4 * n; first += 4 * n)
+		{
+			a0 = o::add(a0, o::load(first));
+			a1 = o::add(a1, o::load(first + n));
+			a2 = o::add(a2, o::load(first + 2 * n));
+			a3 = o::add(a3, o::load(first + 3 * n));
+		}
+		for (; last - first >= n; first += n)
+			a0 = o::add(a0, o::load(first));
+		a0 = o::add(o::add(a0, a1), o::add(a2, a3));
+		T lanes[n];
+		o::store(lanes, a0);
+		T total{};
+		for (auto x : lanes)
+			total = vq::detail::wrapping_add(total, x);
+		for (; first != last; ++first)
+			total = vq::detail::wrapping_add(total, *first);
+		return total;
+	}
+
+	// lowest and highest are updated with the elements in the range
+	template <class T>
+	VECTOR_QUEUE_SIMD_TARGET void minmax(const T* first, const T* last, T& lowest, T& highest)
+	{
+		using o = arith<T>;
+		constexpr ptrdiff_t n = o::lanes;
+		auto lo0 = o::splat(lowest);
+		auto lo1 = lo0;
+		auto hi0 = o::splat(highest);
+		auto hi1 = hi0;
+		for (; last - first >= 2 * n; first += 2 * n)
+		{
+			auto d0 = o::load(first);
+			auto d1 = o::load(first + n);
+			lo0 = o::min_max(lo0, d0, false);
+			lo1 = o::min_max(lo1, d1, false);
+			hi0 = o::min_max(hi0, d0, true);
+			hi1 = o::min_max(hi1, d1, true);
+		}
+		for (; last - first >= n; first += n)
+		{
+			auto d = o::load(first);
+			lo0 = o::min_max(lo0, d, false);
+			hi0 = o::min_max(hi0, d, true);
+		}
+		T lanes[n];
+		o::store(lanes, o::min_max(lo0, lo1, false));
+		for (auto x : lanes)
+			if (x < lowest)
+				lowest = x;
+		o::store(lanes, o::min_max(hi0, hi1, true));
+		for (auto x : lanes)
+			if (highest < x)
+				highest = x;
+		for (; first != last; ++first)
+		{
+			if (*first < lowest)
+				lowest = *first;
+			if (highest < *first)
+				highest = *first;
+		}
+	}
+}
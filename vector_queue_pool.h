@@ -0,0 +1,385 @@
+#pragma once
+/*
+Copyright (c) 2021 Christian Olsson
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <limits>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+#include "vector_queue.h"
+
+// Carves the buffers of many queues out of large slabs instead of giving each its own heap block.
+// A slab holds blocks of one power of two size, a queue that grows moves to a block of the next
+// size in the pool and its old block goes on a free list for the next queue of that size.
+// compact() gives the slabs without any blocks in use back to the heap, compact(queues) first moves
+// the given queues out of sparsely used slabs. Buffers larger than a sixteenth of a slab are
+// allocated directly. A pool isn't thread safe and has to outlive its queues.
+class vector_queue_pool
+{
+public:
+	template <class T>
+	struct allocator
+	{
+		// slab blocks are aligned to 64 bytes but the large buffers come from plain operator new
+		static_assert(alignof(T) <= __STDCPP_DEFAULT_NEW_ALIGNMENT__, "over-aligned types are not supported");
+
+		using value_type = T;
+		using propagate_on_container_copy_assignment = std::true_type;
+		using propagate_on_container_move_assignment = std::true_type;
+		using propagate_on_container_swap = std::true_type;
+		using is_always_equal = std::false_type;
+
+		explicit allocator(vector_queue_pool& pool) noexcept : pool(&pool) {}
+		template <class U>
+		allocator(const allocator<U>& other) noexcept : pool(other.pool) {}
+
+		T* allocate(size_t n)
+		{
+			if (n > std::numeric_limits<size_t>::max() / sizeof(T))
+			{
+#ifndef VECTOR_QUEUE_NO_EXCEPTIONS
+				throw std::bad_array_new_length();
+#else
+				std::abort();
+#endif
+			}
+			return static_cast<T*>(pool->allocate(n * sizeof(T)));
+		}
+
+		void deallocate(T* buffer, size_t n) noexcept
+		{
+			pool->deallocate(buffer, n * sizeof(T));
+		}
+
+		template <class U>
+		friend bool operator==(const allocator& a, const allocator<U>& b) noexcept
+		{
+			return a.pool == b.pool;
+		}
+
+		vector_queue_pool* pool;
+	};
+
+	template <class T>
+	using queue = vector_queue<T, allocator<T>>;
+
+	explicit vector_queue_pool(size_t slab_bytes = size_t(1) << 20) : slab_bytes(slab_bytes)
+	{
+		if (!std::has_single_bit(slab_bytes) || slab_bytes < 16 * min_block_bytes)
+		{
+#ifndef VECTOR_QUEUE_NO_EXCEPTIONS
+			throw std::invalid_argument("slab_bytes has to be a power of two of at least 1 KB");
+#else
+			std::abort();
+#endif
+		}
+	}
+
+	vector_queue_pool(const vector_queue_pool&) = delete;
+	vector_queue_pool& operator=(const vector_queue_pool&) = delete;
+
+	~vector_queue_pool()
+	{
+		for (auto slab : slabs)
+			free_slab(slab);
+	}
+
+	template <class T>
+	queue<T> make_queue()
+	{
+		return queue<T>(allocator<T>(*this));
+	}
+
+	void* allocate(size_t bytes)
+	{
+		size_t block = block_bytes(bytes);
+		if (block > max_block_bytes())
+			return ::operator new(bytes);
+		auto size_class = std::countr_zero(block);
+		void* buffer = free_lists[size_class];
+		if (buffer)
+		{
+			free_lists[size_class] = *static_cast<void**>(buffer);
+		}
+		else
+		{
+			slab_header* slab = carving[size_class];
+			if (!slab || slab->carved + block > slab_bytes)
+			{
+				slab = new_slab(block);
+				carving[size_class] = slab;
+			}
+			buffer = reinterpret_cast<std::byte*>(slab) + slab->carved;
+			slab->carved += block;
+		}
+		++slab_of(buffer)->used;
+		used += block;
+		return buffer;
+	}
+
+	void deallocate(void* buffer, size_t bytes) noexcept
+	{
+		size_t block = block_bytes(bytes);
+		if (block > max_block_bytes())
+		{
+			::operator delete(buffer, bytes);
+			return;
+		}
+		auto size_class = std::countr_zero(block);
+		*static_cast<void**>(buffer) = free_lists[size_class];
+		free_lists[size_class] = buffer;
+		--slab_of(buffer)->used;
+		used -= block;
+	}
+
+	// Move the queues in queues, a range of queue<T>, out of the sparsest slabs of each block size
+	// into free blocks of the fullest ones, then release the slabs left without blocks in use.
+	// Blocks of queues that aren't in the range stay where they are and keep their slab, and the
+	// empty queues in the range give up their buffers. Returns how many slabs were released.
+	template <class Range>
+	size_t compact(Range&& queues)
+	{
+		if (plan_evacuation())
+		{
+			// take the free blocks of the slabs being emptied off the free lists, so the moved
+			// queues land in the slabs that stay
+			void* parked[classes] = {};
+			slab_header* parked_carving[classes] = {};
+			for (int size_class = 0; size_class < classes; ++size_class)
+			{
+				park(size_class, parked);
+				if (carving[size_class] && carving[size_class]->evacuate)
+					std::swap(carving[size_class], parked_carving[size_class]);
+			}
+			for (auto& q : queues)
+				relocate(q, parked);
+			// the slabs that still have blocks in use get their free blocks back
+			for (int size_class = 0; size_class < classes; ++size_class)
+			{
+				slab_header* slab = parked_carving[size_class];
+				if (slab && slab->used != 0 && !carving[size_class])
+					carving[size_class] = slab;
+				while (void* buffer = parked[size_class])
+				{
+					parked[size_class] = *static_cast<void**>(buffer);
+					if (slab_of(buffer)->used != 0)
+					{
+						*static_cast<void**>(buffer) = free_lists[size_class];
+						free_lists[size_class] = buffer;
+					}
+				}
+			}
+			for (auto slab : slabs)
+				slab->evacuate = false;
+		}
+		return compact();
+	}
+
+	// release the slabs that have no blocks in use, returns how many
+	size_t compact()
+	{
+		for (auto slab : slabs)
+			slab->empty = slab->used == 0;
+		for (auto& list : free_lists)
+		{
+			void** link = &list;
+			while (*link)
+			{
+				if (slab_of(*link)->empty)
+					*link = *static_cast<void**>(*link);
+				else
+					link = static_cast<void**>(*link);
+			}
+		}
+		for (auto& slab : carving)
+		{
+			if (slab && slab->empty)
+				slab = nullptr;
+		}
+		size_t released = 0;
+		std::erase_if(slabs, [this, &released](slab_header* slab)
+			{
+				if (!slab->empty)
+					return false;
+				free_slab(slab);
+				++released;
+				return true;
+			});
+		return released;
+	}
+
+	size_t slab_count() const
+	{
+		return slabs.size();
+	}
+
+	// bytes held in slabs
+	size_t reserved_bytes() const
+	{
+		return slabs.size() * slab_bytes;
+	}
+
+	// bytes of the blocks in use, a buffer uses the next power of two of its size
+	size_t used_bytes() const
+	{
+		return used;
+	}
+
+private:
+	static constexpr size_t min_block_bytes = 64;
+	static constexpr int classes = std::numeric_limits<size_t>::digits;
+
+	// at the start of every slab, the blocks start after it
+	struct alignas(min_block_bytes) slab_header
+	{
+		size_t block; // bytes per block
+		size_t carved; // bytes handed out from the start of the slab
+		size_t used; // blocks in use
+		bool empty;
+		bool evacuate;
+	};
+
+	size_t max_block_bytes() const
+	{
+		return slab_bytes / 16;
+	}
+
+	static size_t block_bytes(size_t bytes)
+	{
+		return std::bit_ceil(std::max(bytes, min_block_bytes));
+	}
+
+	slab_header* slab_of(void* buffer) const
+	{
+		return reinterpret_cast<slab_header*>(reinterpret_cast<uintptr_t>(buffer) & ~(slab_bytes - 1));
+	}
+
+	slab_header* new_slab(size_t block)
+	{
+		if (slabs.size() == slabs.capacity())
+			slabs.reserve(slabs.size() * 2 + 8);
+		void* memory = ::operator new(slab_bytes, std::align_val_t(slab_bytes));
+		// the header takes the first block
+		auto slab = new (memory) slab_header{ block, std::max(block, sizeof(slab_header)), 0, false, false };
+		slabs.push_back(slab);
+		return slab;
+	}
+
+	void free_slab(slab_header* slab)
+	{
+		::operator delete(slab, slab_bytes, std::align_val_t(slab_bytes));
+	}
+
+	// Mark the slabs to empty for compact(queues): per block size, the fullest slabs that can hold
+	// all the blocks in use stay and the rest are evacuated. Returns if any slab is marked.
+	bool plan_evacuation()
+	{
+		std::vector<slab_header*> order(slabs);
+		std::sort(order.begin(), order.end(), [](slab_header* a, slab_header* b)
+			{
+				return a->block != b->block ? a->block < b->block : a->used > b->used;
+			});
+		bool any = false;
+		for (auto first = order.begin(); first != order.end();)
+		{
+			size_t block = (*first)->block;
+			auto last = std::find_if(first, order.end(), [block](slab_header* slab) { return slab->block != block; });
+			size_t blocks_per_slab = (slab_bytes - std::max(block, sizeof(slab_header))) / block;
+			size_t in_use = 0;
+			for (auto slab = first; slab != last; ++slab)
+				in_use += (*slab)->used;
+			size_t needed = (in_use + blocks_per_slab - 1) / blocks_per_slab;
+			for (auto slab = first + needed; slab != last; ++slab)
+			{
+				(*slab)->evacuate = (*slab)->used != 0;
+				any = any || (*slab)->evacuate;
+			}
+			first = last;
+		}
+		return any;
+	}
+
+	// move the free blocks of evacuated slabs from a free list to parked
+	void park(int size_class, void** parked)
+	{
+		void** link = &free_lists[size_class];
+		while (*link)
+		{
+			if (slab_of(*link)->evacuate)
+			{
+				void* buffer = *link;
+				*link = *static_cast<void**>(buffer);
+				*static_cast<void**>(buffer) = parked[size_class];
+				parked[size_class] = buffer;
+			}
+			else
+			{
+				link = static_cast<void**>(*link);
+			}
+		}
+	}
+
+	template <class T>
+	void relocate(queue<T>& q, void** parked)
+	{
+		if (q.get_allocator().pool != this || q.capacity() == 0)
+			return;
+		size_t block = block_bytes(q.capacity() * sizeof(T));
+		if (!q.empty() && (block > max_block_bytes() || !slab_of(std::addressof(q.front()))->evacuate))
+			return;
+		{
+			queue<T> moved(q.get_allocator());
+			if (!q.empty())
+			{
+				moved.reserve(q.capacity());
+				for (auto& value : q)
+					moved.push_back(std::move_if_noexcept(value));
+			}
+			q.swap(moved);
+		}
+		// the old block went to the front of its free list, park it so the next queue doesn't take it
+		if (block <= max_block_bytes())
+		{
+			auto size_class = std::countr_zero(block);
+			void* buffer = free_lists[size_class];
+			if (buffer && slab_of(buffer)->evacuate)
+			{
+				free_lists[size_class] = *static_cast<void**>(buffer);
+				*static_cast<void**>(buffer) = parked[size_class];
+				parked[size_class] = buffer;
+			}
+		}
+	}
+
+	size_t slab_bytes;
+	size_t used = 0;
+	std::vector<slab_header*> slabs;
+	void* free_lists[classes] = {};
+	slab_header* carving[classes] = {};
+};
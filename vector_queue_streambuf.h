@@ -0,0 +1,134 @@
+#pragma once
+/*
+Copyright (c) 2021 Christian Olsson
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <streambuf>
+#include <string>
+#include "vector_queue.h"
+
+// A streambuf that reads from the front and writes to the back of a vector_queue without copying.
+// The get area is the contiguous segment at the front of the queue and the put area is the
+// contiguous free space after the back. Call pubsync() before touching the queue directly.
+template <class CharT, class Traits = std::char_traits<CharT>, class Alloc = std::allocator<CharT>>
+class basic_vector_queue_streambuf : public std::basic_streambuf<CharT, Traits>
+{
+public:
+	using queue_type = vector_queue<CharT, Alloc>;
+	using char_type = CharT;
+	using traits_type = Traits;
+	using int_type = typename Traits::int_type;
+
+	explicit basic_vector_queue_streambuf(queue_type& queue) : queue(&queue)
+	{}
+
+	basic_vector_queue_streambuf(const basic_vector_queue_streambuf&) = delete;
+	basic_vector_queue_streambuf& operator=(const basic_vector_queue_streambuf&) = delete;
+
+	~basic_vector_queue_streambuf()
+	{
+		sync();
+	}
+
+	queue_type& get_queue() const
+	{
+		return *queue;
+	}
+
+protected:
+	int_type underflow() override
+	{
+		commit_put();
+		this->setp(nullptr, nullptr);
+		consume_get();
+		if (queue->empty())
+		{
+			queue->set_start(0);
+			this->setg(nullptr, nullptr, nullptr);
+			return traits_type::eof();
+		}
+		auto first = queue->array + queue->start();
+		auto length = std::min(queue->size(), queue->capacity() - queue->start());
+		this->setg(first, first, first + length);
+		return traits_type::to_int_type(*first);
+	}
+
+	int_type overflow(int_type ch) override
+	{
+		commit_put();
+		if (traits_type::eq_int_type(ch, traits_type::eof()))
+			return traits_type::not_eof(ch);
+		if (queue->size() == queue->capacity())
+		{
+			// elements are moved by the reallocation so the get area is dropped
+			consume_get();
+			this->setg(nullptr, nullptr, nullptr);
+			queue->grow();
+		}
+		auto back = queue->wrap_up(queue->size());
+		auto first = queue->array + back;
+		if (back >= queue->start())
+			this->setp(first, queue->array + queue->capacity());
+		else
+			this->setp(first, queue->array + queue->start());
+		*this->pptr() = traits_type::to_char_type(ch);
+		this->pbump(1);
+		return ch;
+	}
+
+	int sync() override
+	{
+		commit_put();
+		consume_get();
+		this->setp(nullptr, nullptr);
+		this->setg(nullptr, nullptr, nullptr);
+		return 0;
+	}
+
+	std::streamsize showmanyc() override
+	{
+		commit_put();
+		consume_get();
+		return std::streamsize(queue->size());
+	}
+
+private:
+	// make the characters written to the put area part of the queue
+	void commit_put()
+	{
+		queue->_size += this->pptr() - this->pbase();
+		this->setp(this->pptr(), this->epptr());
+	}
+
+	// pop the characters read from the get area
+	void consume_get()
+	{
+		size_t n = this->gptr() - this->eback();
+		queue->set_start(queue->wrap_up(n));
+		queue->_size -= n;
+		this->setg(this->gptr(), this->gptr(), this->egptr());
+	}
+
+	queue_type* queue;
+};
+
+using vector_queue_streambuf = basic_vector_queue_streambuf<char>;
+using vector_queue_wstreambuf = basic_vector_queue_streambuf<wchar_t>;